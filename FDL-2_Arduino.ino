@@ -8,6 +8,7 @@
 */
 
 #define DEBUG
+//#define TASK_REPORT															// task statistics on every fire button release, ~30ms on the serial line
 
 /* myfunc library holds the waittimer, some hardware setup functions and the pin change interrupt handling */
 #include "myfunc.h"
@@ -17,12 +18,26 @@
 /* display related */
 // https://github.com/olikraus/u8g2/wiki/u8g2install
 #include <U8g2lib.h>
-U8G2_SSD1306_128X64_NONAME_1_HW_I2C u8g2(U8G2_R0, /* reset=*/ U8X8_PIN_NONE);
+uint8_t u8x8_byte_twi(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+class U8G2_SSD1306_128X64_NONAME_1_TWI : public U8G2 {							// same as the _1_HW_I2C one, but on the twi queue of myfunc
+public:
+	U8G2_SSD1306_128X64_NONAME_1_TWI(const u8g2_cb_t *rotation) : U8G2() {
+		u8g2_Setup_ssd1306_i2c_128x64_noname_1(&u8g2, rotation, u8x8_byte_twi, u8x8_gpio_and_delay_arduino);
+	}
+};
+U8G2_SSD1306_128X64_NONAME_1_TWI u8g2(U8G2_R0);
 #include "mylogo.h"
 waittimer display_timer;
 uint8_t display_timeout;
 uint8_t display_mode;
+uint8_t display_dirty;															// tile rows to be sent, one bit per 8 pixel row, picked up by the display task
+#define DISPLAY_ROW     160														// twi queue bytes for one tile row, 128 data, commands and 24 byte chunks
+uint8_t display_battery = 0xff;													// battery level on the display, 0xff forces the first draw
 uint8_t menu_item, menu_select;
+#define MENU_ITEMS      (sizeof(menu) / sizeof(menu[0]))						// items of the menu table, behind the settings
+#define MENU_LINES      4														// lines on the status screen
+#define LINE_Y(i)       (22 + (i) * 14)											// base line of a status line, first at 22 of 64, 14 per line
+uint32_t display_line[MENU_LINES];												// item, marker and value of every line on the display
 // ------------------------------------------------------------------------------------------------
 
 
@@ -39,28 +54,86 @@ waittimer encoder_timeout;
 /* pusher to shift the dart into the launcher */
 #include <Servo.h>
 #include "motors.h"
-LauncherClass launcher(pinB2, 1000, 2000);
+#define fdl2_tach       NO_PIN													// pinD4 with a hall sensor on the flywheel, launcher is ready on speed then
+LauncherClass<pinB2, fdl2_tach> launcher(1000, 2000, 30000);					// esc pulse 1000 to 2000 us, 30000 rpm at full throttle
 uint8_t x = 1;
-PusherClass pusher(pinB5, pinB4, pinB3, pinB1, pinD7, pinD6, launcher.ready);
+PusherClass<pinB5, pinB4, pinB3, pinB1, pinD7, pinD6> pusher(launcher.ready);
 // ------------------------------------------------------------------------------------------------
 
 
-/* battery related, functionality sits within the loop function in the main sketch */
+/* battery related, the adc samples in the background, the battery task scales the filtered values */
 // 892 = 12.35 Volt 
 #define fdl2_battery    pinC3
+#define BAT_SCALE       886														// mV per block sum * 1024, 13.85 mV per adc step / ADC_OVERSAMPLE
 waittimer battery_timer;
 uint8_t battery_level;
+uint16_t battery_mv;															// battery voltage at rest, gives the level for the display
+uint16_t battery_load_mv;														// battery voltage while the motors run, the launcher throttle is scaled with it
+uint8_t battery_due;															// set by the battery timer, scaling is done in the battery task
 // ------------------------------------------------------------------------------------------------
 
+#define MAX_BURST       9														// longest burst in settings.mode
+#define MAX_RATE        15														// highest darts per second in settings.rate
+
+/* settings are kept in a journal behind the learned spin-up table and throttle curve. up to the magic 0x1238 they were
+** a fixed block at eeprom address 2, setup() takes such a block over once. new fields go to the end of the struct, an
+** older record leaves them at their defaults then. SETTINGS_VERSION is raised only if a field changes its meaning */
+#define EE_LEARN        16														// learned spin-up table and throttle curve
+#define EE_JOURNAL      64														// settings journal up to the end of the eeprom
+#define SETTINGS_VERSION 1
+#define SETTINGS_DELAY  2000													// ms after the last change, more changes meanwhile give one record
+const s_journal_block settings_old[] = { { 0x1236, 7 }, { 0x1237, 9 }, { 0x1238, 10 } };	// fixed blocks at address 0 before the journal
 struct s_settings {
-	uint8_t  mode = 2;															// how many darts per fire push
-	uint8_t  fire_speed = 80;													// fire speed in % of max_speed
+	uint8_t  mode = 2;															// how many darts per fire push, 0 is unlimited
+	uint8_t  fire_speed = 80;													// fire speed in % of max_rpm
 	uint16_t speedup_time = 500;												// holds the time the motor needs to speedup
-	uint8_t  standby_speed = 50;												// standby speed in % of max_speed
+	uint8_t  standby_speed = 50;												// standby speed in % of max_rpm
 	uint16_t standby_time = 500;												// standby time in ms
+	uint8_t  rate = 0;															// darts per second, 0 is full speed
+	uint8_t  recover = 0;														// ms the pusher holds at most between two darts for the flywheels, 0 is off
+	uint8_t  ramp = 0;															// launcher spin-up profile, 0 off, 1 linear, 2 s-curve, 3 current limited
 }settings;
+static_assert(sizeof(s_settings) <= JOURNAL_DATA, "settings don't fit a journal record");
+static_assert(EE_LEARN + LEARN_SIZE <= EE_JOURNAL, "learned tables run into the journal");
+journal settings_journal(EE_JOURNAL, E2END + 1);
+waittimer settings_timer;
+
+/* menu table, one line per setting. the engine in encoder_up(), encoder_down() and draw_item() works only with the
+** table, so a new setting needs only a new line here and costs no ram. the table is copied line by line from flash */
+#define MENU_WRAP       1														// flags, value goes round from max to min and back
+
+struct s_menu {
+	char     label[12];															// text in front of the value
+	uint8_t  offset;															// of the field in s_settings
+	uint8_t  size;																// of the field, 1 or 2 byte
+	uint16_t min, max;
+	uint8_t  step;																// per encoder step
+	uint8_t  flags;
+	void(*print)(uint16_t value);												// formatter for the value
+};
+
+void print_mode(uint16_t value);
+void print_percent(uint16_t value);
+void print_ms(uint16_t value);
+void print_rate(uint16_t value);
+void print_off_ms(uint16_t value);
+void print_ramp(uint16_t value);
+
+#define MENU_FIELD(f)   offsetof(s_settings, f), sizeof(s_settings::f)
+
+const s_menu menu[] PROGMEM = {
+	{ "Mode: ",       MENU_FIELD(mode),          0, MAX_BURST,     1,   MENU_WRAP, print_mode },
+	{ "Speed: ",      MENU_FIELD(fire_speed),    50, 100,          5,   0,         print_percent },
+	{ "Spin-up: ",    MENU_FIELD(speedup_time),  200, 1000,        50,  0,         print_ms },
+	{ "Standby: ",    MENU_FIELD(standby_speed), 0, 90,            5,   0,         print_percent },
+	{ "Stby time: ",  MENU_FIELD(standby_time),  0, 3000,          100, 0,         print_off_ms },
+	{ "Rate: ",       MENU_FIELD(rate),          0, MAX_RATE,      1,   0,         print_rate },
+	{ "Recover: ",    MENU_FIELD(recover),       0, 250,           10,  0,         print_off_ms },
+	{ "Ramp: ",       MENU_FIELD(ramp),          0, RAMP_PROFILES, 1,   0,         print_ramp },
+};
 
 #define fdl2_fire       pinD5
+#define fdl2_rev        NO_PIN													// optional rev switch, low active, pre-revs the launcher
 
 
 void setup() {
@@ -72,117 +145,238 @@ void setup() {
 
 	u8g2.begin();																// init the display and show some start message
 	display_welcome();															// show the welcome screen
+	display_timer.set_callback(display_timer_cb);								// regular display update, dispatched by the timer service
 	display_timer.set(5000);													// schedule next regular update
+	encoder_timeout.set_callback(encoder_timeout_cb);							// leave the menu after some time without encoder action
 
-	analogReference(INTERNAL);													// battery reference to 1.1 Volt
-	analogRead(fdl2_battery);
-	battery_timer.set(1000);
+	init_adc(fdl2_battery);														// battery sampled in the background, reference 1.1 Volt
+	battery_timer.set_callback(battery_timer_cb);								// battery measurement, dispatched by the timer service
+	battery_timer.set(50);														// first filtered value is there after two blocks
 
 	launcher.init();															// init the launcher
 	register_PCINT(encoder_click);												// init and register the click encoder button
-	register_PCINT(fdl2_fire);													// init and register the fire button as interrupt
 
-	/* read defaults from eeprom in case that the magic number is ok */
+	/* newest record of the settings journal, without one the old block behind the magic or the defaults */
 	dbg << F("read settings from eeprom\n");
 
-	uint16_t magic;
-	get_eeprom(0, 2, &magic);
-	if (magic != 0x1236) {														// magic number doesn't fit, so a new config needs written
-		magic = 0x1236;															// set a magic number
-		set_eeprom(0, 2, &magic);												// write the magic to the eeprom
-		set_eeprom(2, 7, &settings);											// write the settings
-		dbg << F("magic doesn't fit, write defaults\n");
+	if (!settings_journal.load(&settings, sizeof(settings))) {
+		uint8_t len = settings_journal.adopt(0, settings_old, sizeof(settings_old) / sizeof(settings_old[0]), &settings, sizeof(settings));
+		if (!len) clear_eeprom(EE_LEARN, LEARN_SIZE);							// nothing learned yet
+		settings_journal.save(&settings, sizeof(settings), SETTINGS_VERSION);	// first record, written by the settings task
+		dbg << F("no settings record, ") << ((len) ? F("old block taken over\n") : F("write defaults\n"));
 	}
-
-	get_eeprom(2, 7, &settings);												// read the settings
+	settings_timer.set_callback(settings_timer_cb);								// deferred journal record after menu changes
 
 	pusher.mode = &settings.mode;												// how many darts per fire push
-	launcher.fire_speed = &settings.fire_speed;									// fire speed in % of max_speed
+	pusher.rate = &settings.rate;												// darts per second
+	pusher.recover = &settings.recover;											// longest hold between two darts
+	pusher.recovered = &launcher.recovered;										// flywheel speed is back after a dart
+	pusher.set_dart_callback(launcher.dart_cb, &launcher);						// pushed darts feed the droop model of the launcher
+	launcher.fire_speed = &settings.fire_speed;									// fire speed in % of max_rpm
 	launcher.speedup_time = &settings.speedup_time;								// holds the time the motor needs to speedup
-	launcher.standby_speed = &settings.standby_speed;							// standby speed in % of max_speed
+	launcher.standby_speed = &settings.standby_speed;							// standby speed in % of max_rpm
 	launcher.standby_time = &settings.standby_time;								// standby time in ms
+	launcher.ramp = &settings.ramp;												// spin-up profile
+	launcher.battery = &battery_level;											// spin-up time depends on the battery
+	launcher.volt = &battery_load_mv;											// throttle follows the battery voltage under load
+	launcher.learn(EE_LEARN);													// learned spin-up times and throttle curve
+
+	/* the trigger isr starts pusher and launcher at once, so the edges are taken only after all pointers are wired */
+	subscribe_PCINT(fdl2_fire, trigger_edge);									// init and register the fire button, starts pusher and launcher from the isr
+	if (fdl2_rev != NO_PIN) subscribe_PCINT(fdl2_rev, rev_edge);				// rev switch, pre-revs the launcher from the isr
 	
+	/* tasks, priority 0 runs every loop pass, the background tasks get one slice per pass */
+	tasks.add(task_trigger, 0, F("trigger"));									// fire button, starts pusher and launcher
+	tasks.add(task_pusher, 0, F("pusher"));										// pusher state machine
+	tasks.add(task_timers, 0, F("timers"));										// timer service, launcher state machine and all other deadlines
+	tasks.add(task_launcher, 0, F("launcher"));									// keeps the esc output alive
+	tasks.add(task_encoder, 1, F("encoder"));									// menu handling
+	tasks.add(task_battery, 2, F("battery"));									// battery measurement
+	tasks.add(task_settings, 2, F("settings"));									// settings journal and learned data, one eeprom byte per slice
+	tasks.add(task_display, 3, F("display"));									// display update, one changed tile row per slice
+
 	dbg << F("init complete, mode: ") << *pusher.mode << F(", speed: ") << *launcher.fire_speed << F(", speedup_time: ") << *launcher.speedup_time << F(", standby_speed: ") << *launcher.standby_speed << F(", standby_time: ") << *launcher.standby_time << F("\n\n");
 }
 
 
 void loop() {
+	prof_mark(PROF_LOOP);														// loop jitter marker for the simavr benchmark
+	tasks.run();																// fire path first, then one background slice
+}
+
+
+/* leading edge of the fire button, called in the pin change isr. pusher and launcher start without waiting for the
+** main loop, their state machine steps in the main loop run with interrupts off, so this is safe */
+void trigger_edge(void *, uint8_t pin_def, uint8_t level, uint32_t time) {
+	if (!level) {
+		pusher.start();
+		launcher.start();
+	} else {
+		pusher.stop();
+		launcher.stop();
+	}
+}
+
+/* rev switch pressed, a shot is likely */
+void rev_edge(void *, uint8_t pin_def, uint8_t level, uint32_t time) {
+	if (!level) launcher.prerev();
+}
+
+/* check fire button continously, pusher and launcher are driven by trigger_edge(), here is only the debug */
+uint8_t task_trigger() {
+	uint8_t x = check_PCINT(fdl2_fire, 1);
+	if (x == 2) {
+		dbg << F("M::Fire button pushed\n");
+		return 1;
+
+	} else if (x == 3) {
+		dbg << F("M::Fire button released\n");
+#ifdef TASK_REPORT
+		tasks.report(dbg);														// blocks the fire path while it prints, so only on request
+#endif
+		return 1;
+	}
+	return 0;
+}
 
-	/* general poll function */
+/* general poll function, the pin change events queued by the isr are handled first */
+uint8_t task_pusher() {
+	s_pcint_event ev;
+	while (get_PCINT_event(&ev)) pusher.event(ev);
 	pusher.poll();
-	launcher.poll();
+	uint32_t us;
+	if (pusher.latency(&us)) tasks.latency(us);									// trigger to pusher motor
+	return 1;
+}
+
+/* timer service, reads the clock once and dispatches the launcher state machine, display, battery and
+** encoder timeout only when their deadline is reached */
+uint8_t task_timers() {
+	timers.poll();
+	return 1;
+}
 
+/* esc output, repeats the dshot frame, nothing to do with the servo output */
+uint8_t task_launcher() {
+	adc_load = launcher.running() | pusher.running();							// battery samples go to the load channel
+	return launcher.service();
+}
 
-	/* poll the encoder regulary */
+/* poll the encoder regulary */
+uint8_t task_encoder() {
 	int8_t enc_value = encoder.getValue();										// check if the encoder value had changed
 	if (enc_value > 0) encoder_up(enc_value);
 	if (enc_value < 0) encoder_down(enc_value);
-	
+
 	int8_t enc_button = check_PCINT(encoder_click, 1);							// check the encoder button
 	if (enc_button > 1) encoder_button(enc_button);
 
-	if (encoder_timeout.done()) {
-		menu_item = 0;
-		menu_select = 0;
-	}
+	return (enc_value || (enc_button > 1)) ? 1 : 0;
+}
 
+/* battery measurement, requested by the battery timer */
+uint8_t task_battery() {
+	if (!battery_due) return 0;
+	battery_due = 0;
 
-	/* poll the status display function */
-	if (display_timer.done()) {
-		display_status();
-		display_timer.set(5000);
-	}
+	battery_mv = (uint32_t)get_adc(0) * BAT_SCALE >> 10;						// filtered block sum to milli volt
+	battery_load_mv = (uint32_t)get_adc(1) * BAT_SCALE >> 10;
+	if (!battery_load_mv) battery_load_mv = battery_mv;							// motors didn't run yet
+	if (!battery_mv) battery_mv = battery_load_mv;								// motors ran all the time since the start
+	//dbg << F("battery_mv: ") << battery_mv << F(", load: ") << battery_load_mv << '\n';
+
+	if (battery_mv > 9900) battery_level = (battery_mv - 9900) / 27;			// calculate the percentage level of the battery
+	else battery_level = 0;														// this value is available outside of this function
 
+	//display_battery_update(battery_level);										// write it into the display
+	return 1;
+}
 
-	/* poll the battery measurement function */
-	if (battery_timer.done()) {
-		uint32_t bat_value = analogRead(fdl2_battery);							// read the io pin
-		bat_value *= 1385;														// some math to get the milli volt value
-		bat_value /= 1000;
-		//dbg << F("bat_value: ") << bat_value << '\n';
+/* settings journal and the learned spin-up table, written byte by byte while the motors are stopped. the eeprom works
+** on a byte for 3.4ms, both skip the slice till it is done, so the loop never waits for it */
+uint8_t task_settings() {
+	if (launcher.running() || pusher.running()) return 0;
+	if (settings_journal.poll()) return 1;
+	return launcher.save();
+}
 
-		if (bat_value > 990) battery_level = (bat_value - 990) * 10 / 27;		// calculate the percentage level of the battery
-		else battery_level = 0;													// this value is available outside of this if clause
+/* display update, one changed tile row per call, so the fire path gets its turn between the rows. the page buffer
+** is moved to the row, the whole status screen is drawn into it, u8g2 clips everything outside, and only this row is sent */
+uint8_t task_display() {
+	if (!display_dirty) return 0;												// nothing changed
+	if (twi_free() < DISPLAY_ROW) return 0;										// last row is still on the bus, changes meanwhile go into the same rows
+
+	uint8_t row = 0;
+	while (!(display_dirty & _BV(row))) row++;									// first changed row
+	display_dirty &= ~_BV(row);
+
+	u8g2.setBufferCurrTileRow(row);
+	u8g2.clearBuffer();
+	draw_status();																// draw into the page of this row
+	u8g2.sendBuffer();															// 128 bytes instead of the whole screen, sent by the twi isr
+	return 1;
+}
 
-		//display_battery_update(battery_level);									// write it into the display
-		battery_timer.set(5000);												// set next time to measure
+/* u8x8 byte transport on the twi queue, the transfer is sent in the background after END_TRANSFER */
+uint8_t u8x8_byte_twi(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+	uint8_t *data = (uint8_t*)arg_ptr;
+
+	switch (msg) {
+	case U8X8_MSG_BYTE_INIT:
+		init_twi(400000);														// the ssd1306 is fine with fast mode
+		break;
+	case U8X8_MSG_BYTE_START_TRANSFER:
+		twi_begin(u8x8_GetI2CAddress(u8x8) >> 1);								// u8x8 keeps the address shifted
+		break;
+	case U8X8_MSG_BYTE_SEND:
+		while (arg_int--) twi_write(*data++);
+		break;
+	case U8X8_MSG_BYTE_END_TRANSFER:
+		twi_end();
+		break;
+	case U8X8_MSG_BYTE_SET_DC:
+		break;
+	default:
+		return 0;
 	}
+	return 1;
+}
 
 
-	/* check fire button continously and drive pusher */
-	uint8_t x = check_PCINT(fdl2_fire, 1);
-	if (x == 2) {
-		pusher.start();
-		launcher.start();
-		dbg << F("M::Fire button pushed\n");
+/* encoder timeout, leave the menu */
+void encoder_timeout_cb(void *) {
+	if (menu_item) launcher.prerev();											// leaving the menu, a shot is likely
+	menu_item = 0;
+	menu_select = 0;
+}
 
-	} else if (x == 3) {
-		pusher.stop();
-		launcher.stop();
-		dbg << F("M::Fire button released\n");
-	}
+/* regular status display update */
+void display_timer_cb(void *) {
+	display_status();
+	display_timer.set(5000);
+}
 
+/* battery measurement, the scaling is done in the battery task */
+void battery_timer_cb(void *) {
+	battery_due = 1;
+	battery_timer.set(250);														// the adc is filtered already, so this is cheap
+}
+
+/* menu changes came to rest, stage the journal record */
+void settings_timer_cb(void *) {
+	settings_journal.save(&settings, sizeof(settings), SETTINGS_VERSION);		// nothing if all changes were taken back
 }
 
 
 void encoder_up(int8_t x) {
 
 	if (menu_select == 0) {
-		if (menu_item >= 2) menu_item = 0;
+		if (menu_item >= MENU_ITEMS) menu_item = 0;
 		else menu_item++;
 		//dbg << F("u: ") << menu_item << '\n';
 	}
 
-	if (menu_select == 1) {
-		if (menu_item == 1) {
-			settings.mode += 1;
-			if (settings.mode > 3) settings.mode = 0;
-		}
-		if (menu_item == 2) {
-			settings.fire_speed += 5;
-			if (settings.fire_speed  > 100) settings.fire_speed = 100;
-		}
-	}
+	if (menu_select == 1) menu_step(menu_item, 1);								// change the value of the selected item
 
 	display_status();
 	encoder_timeout.set(5000);
@@ -190,22 +384,13 @@ void encoder_up(int8_t x) {
 
 void encoder_down(int8_t x) {
 	if (menu_select == 0) {
-		if (menu_item == 0) menu_item = 2;
+		if (menu_item == 0) menu_item = MENU_ITEMS;
 		else menu_item--;
 		encoder_timeout.set(10000);
 		//dbg << F("d: ") << menu_item << '\n';
 	}
 
-	if (menu_select == 1) {
-		if (menu_item == 1) {
-			if (settings.mode == 0) settings.mode = 3;
-			else settings.mode -= 1;
-		}
-		if (menu_item == 2) {
-			settings.fire_speed -= 5;
-			if (settings.fire_speed  < 50) settings.fire_speed = 50;
-		}
-	}
+	if (menu_select == 1) menu_step(menu_item, -1);
 
 	display_status();
 	encoder_timeout.set(10000);
@@ -217,8 +402,9 @@ void encoder_button(int8_t x) {
 	menu_select++;															// increase the select
 
 	if (menu_select >= 2) {													// menu select 2 means, we are in edit mode
-		set_eeprom(2, 7, &settings);										// write the settings
+		settings_timer.set(SETTINGS_DELAY);									// journal record once the changes came to rest
 		menu_select = 0;													// back for a new select
+		launcher.prerev();													// setting done, a shot is likely
 	}
 	//dbg << F("p: ") << x << F(", ") << menu_select << '\n';
 
@@ -227,33 +413,121 @@ void encoder_button(int8_t x) {
 }
 
 
+/* one step up or down of a setting, within min and max of its menu line */
+void menu_step(uint8_t item, int8_t dir) {
+	if ((!item) || (item > MENU_ITEMS)) return;
+	s_menu m;
+	memcpy_P(&m, &menu[item - 1], sizeof(m));
+
+	int32_t value = (int32_t)menu_value(item) + dir * m.step;
+	if (value > m.max) value = (m.flags & MENU_WRAP) ? m.min : m.max;
+	if (value < m.min) value = (m.flags & MENU_WRAP) ? m.max : m.min;
+
+	uint8_t *field = (uint8_t*)&settings + m.offset;
+	if (m.size == 2) *(uint16_t*)field = value;
+	else *field = value;
+}
+
+/* value of the setting behind a menu line */
+uint16_t menu_value(uint8_t item) {
+	uint8_t *field = (uint8_t*)&settings + pgm_read_byte(&menu[item - 1].offset);
+	return (pgm_read_byte(&menu[item - 1].size) == 2) ? *(uint16_t*)field : *field;
+}
+
+
+/* compares every field of the status screen with what is on the display and marks the tile rows of the changed fields,
+** the display task sends them. a row marked while the task is on another one follows after it */
 void display_status() {
+	if (display_battery == 0xff) display_dirty = 0xff;							// first status screen replaces the whole welcome screen
+	if (battery_level != display_battery) {										// battery bar and percent, font is 6x12
+		display_battery = battery_level;
+		display_dirty |= display_rows(0, 10);
+	}
 
-	u8g2.firstPage();														// reset the buffer page counter													
+	uint8_t first = (menu_item > MENU_LINES) ? menu_item - MENU_LINES + 1 : 1;	// same scroll as in draw_status()
+	for (uint8_t i = 0; i < MENU_LINES; i++) {
+		uint32_t key = status_line_key(first + i);
+		if (key == display_line[i]) continue;
+		display_line[i] = key;
+		display_dirty |= display_rows(LINE_Y(i) - 11, LINE_Y(i) + 3);			// font is 7x14, 11 above and 3 below the base line
+	}
+}
+
+/* mask of the 8 pixel tile rows a field from y top to y bottom touches */
+uint8_t display_rows(uint8_t top, uint8_t bottom) {
+	if (bottom > 63) bottom = 63;
+	return (uint8_t)((0xff << (top >> 3)) & (0xff >> (7 - (bottom >> 3))));
+}
+
+/* draws the status screen into the current u8g2 page */
+void draw_status() {
+	draw_battery(battery_level);											// write the battery level
+
+	u8g2.setFont(u8g2_font_7x14B_tr);										// we use a different font for the menu
+
+	uint8_t first = (menu_item > MENU_LINES) ? menu_item - MENU_LINES + 1 : 1;	// scroll, so the selected item is always visible
+	for (uint8_t i = 0; i < MENU_LINES; i++) {
+		u8g2.setCursor(0, LINE_Y(i));
+		draw_item(first + i);
+	}
+}
+
+/* draws one line of the status screen, label and formatter come from the menu table */
+void draw_item(uint8_t item) {
+	u8g2.print(status_line_item(item));										// get the status of the line item
+	if ((!item) || (item > MENU_ITEMS)) return;
+
+	s_menu m;
+	memcpy_P(&m, &menu[item - 1], sizeof(m));
+	u8g2.print(m.label);
+	m.print(menu_value(item));
+}
 
-	do {																	// step through the different pages
-		draw_battery(battery_level);										// write the battery level
+void print_mode(uint16_t value) {
+	if (value == 0) u8g2.print(F("unlimited"));
+	if (value == 1) u8g2.print(F("single"));
+	if (value == 2) u8g2.print(F("double"));
+	if (value == 3) u8g2.print(F("tripple"));
+	if (value > 3) {
+		u8g2.print(F("burst "));
+		u8g2.print(value);
+	}
+}
 
-		u8g2.setFont(u8g2_font_7x14B_tr);									// we use a different font for the menu
+void print_percent(uint16_t value) {
+	u8g2.print(value);
+	u8g2.print('%');
+}
 
-		u8g2.setCursor(0, 35);												// set the curser to line 35 of 64
+void print_ms(uint16_t value) {
+	u8g2.print(value);
+	u8g2.print(F("ms"));
+}
 
-		u8g2.print(status_line_item(1));									// get the status of the line item
-		u8g2.print(F("Mode: "));
-		if (settings.mode == 0) u8g2.print(F("unlimited"));
-		if (settings.mode == 1) u8g2.print(F("single"));
-		if (settings.mode == 2) u8g2.print(F("double"));
-		if (settings.mode == 3) u8g2.print(F("tripple"));
+void print_rate(uint16_t value) {
+	if (value) {
+		u8g2.print(value);
+		u8g2.print(F("/s"));
+	} else u8g2.print(F("max"));
+}
 
-		u8g2.setCursor(0, 55);
+void print_off_ms(uint16_t value) {
+	if (value) print_ms(value);
+	else u8g2.print(F("off"));
+}
 
-		u8g2.print(status_line_item(2));									// get the status of the line item
-		u8g2.print(F("Speed: "));											
-		u8g2.print(settings.fire_speed);
-		u8g2.print("%");
+void print_ramp(uint16_t value) {
+	if (value == 0) u8g2.print(F("off"));
+	if (value == 1) u8g2.print(F("linear"));
+	if (value == 2) u8g2.print(F("s-curve"));
+	if (value == 3) u8g2.print(F("current"));
+}
 
-	} while (u8g2.nextPage());												// step throug the buffer pages till the end
-	//dbg << F("status display update ") << _TIME << '\n';
+/* item number, marker and setting of a line in one value, a line needs a redraw if its key changed */
+uint32_t status_line_key(uint8_t item) {
+	uint16_t value = ((item) && (item <= MENU_ITEMS)) ? menu_value(item) : 0;
+	uint8_t mark = status_line_item(item);
+	return ((uint32_t)((item << 2) | ((mark == '>') ? 1 : (mark == '#') ? 2 : 0)) << 16) | value;
 }
 
 char status_line_item(uint8_t item_nr) {
@@ -270,16 +544,15 @@ char status_line_item(uint8_t item_nr) {
 
 }
 
-/* draws the welcome screen on the display, battery level follows later */
+/* draws the welcome screen on the display, battery level follows later. the logo covers the whole screen, so every
+** page is expanded straight into the page buffer of u8g2 and sent, there is no need to clear the display before */
 void display_welcome() {
-	//u8g2.clearDisplay();													// clear the display
-	u8g2.clear();
-
-	u8g2.firstPage();														// start with the first buffer
-
-	do {																	// loop throug all buffers
-		u8g2.drawXBMP(0, 0, 128, 64, testbmp_bits);							// and draw the bitmap
-	} while (u8g2.nextPage());												// till the last page
+	const uint8_t *src = logo_rle;
+	for (uint8_t row = 0; row < logo_rows; row++) {								// one page per tile row
+		u8g2.setBufferCurrTileRow(row);
+		src = rle_expand(src, u8g2.getBufferPtr(), logo_width);					// next row of the logo, the page is as wide as the logo
+		u8g2.sendBuffer();
+	}
 	dbg << F("show welcome screen ") << _TIME << '\n';						// some debug
 }
 
@@ -303,8 +576,10 @@ void draw_battery(uint8_t battery) {
 
 
 ISR(TIMER0_COMPA_vect) {
+	prof_mark(PROF_T0_ENTER);
 	++milliseconds;
 	encoder.service();
+	prof_mark(PROF_T0_EXIT);
 }
 
 
@@ -0,0 +1,206 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - hardware abstraction, atmega backend for timer, eeprom and interrupt vectors -------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+#if defined(__AVR__)
+
+#include "myfunc.h"
+#include <util/twi.h>
+
+
+/*-- interrupt functions --------------------------------------------------------------------------------------------------
+* interrupt vectors to catch pin change interrupts, the handling itself is hardware independent in maintain_PCINT()
+*/
+#ifdef PCIE0
+ISR(PCINT0_vect) {
+	prof_mark(PROF_PCINT_ENTER + 0);
+	maintain_PCINT(0);
+	prof_mark(PROF_PCINT_EXIT + 0);
+}
+#endif
+
+#ifdef PCIE1
+ISR(PCINT1_vect) {
+	prof_mark(PROF_PCINT_ENTER + 1);
+	maintain_PCINT(1);
+	prof_mark(PROF_PCINT_EXIT + 1);
+}
+#endif
+
+#ifdef PCIE2
+ISR(PCINT2_vect) {
+	prof_mark(PROF_PCINT_ENTER + 2);
+	maintain_PCINT(2);
+	prof_mark(PROF_PCINT_EXIT + 2);
+}
+#endif
+
+#ifdef PCIE3
+ISR(PCINT3_vect) {
+	prof_mark(PROF_PCINT_ENTER + 3);
+	maintain_PCINT(3);
+	prof_mark(PROF_PCINT_EXIT + 3);
+}
+#endif
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- timer functions ------------------------------------------------------------------------------------------------------
+* as i don't want to depend on the arduino timer while it is not possible to add some time after the arduino was sleeping
+* i defined a new timer. to keep it as flexible as possible you can configure the different timers in the arduino by handing
+* over the number of the timer you want to utilize. as timer are very vendor related there is the need to have at least
+* timer 0 available for all different hardware.
+*/
+// https://github.com/zkemble/millis/blob/master/millis/
+volatile uint32_t milliseconds;
+
+#define T0_TOP     ((F_CPU / 64 / 1000) - 1)													// compare value, ctc counts 0 to T0_TOP, so one period is T0_TOP + 1 ticks
+#define T0_TICK_US (64 / (F_CPU / 1000000UL))												// microseconds per timer tick, 4 at 16 MHz
+
+void init_millis_timer0() {
+	dbg << F("init timer0\n");
+	//power_timer0_enable();
+
+	TCCR0A = _BV(WGM01);																	// CTC mode
+	TCCR0B = (_BV(CS01) | _BV(CS00));														// prescaler 64; 16.000.000 / 64 = 250.000 / 1000 = 250 ticks per ms
+	TIMSK0 = _BV(OCIE0A);
+	OCR0A = T0_TOP;																			// 249, the compare match happens every 250 ticks
+}
+
+uint32_t get_millis(void) {
+	uint32_t ms;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = milliseconds;
+	}
+	return ms;
+}
+
+uint32_t get_micros(void) {
+	uint32_t ms;
+	uint8_t cnt, pending;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = milliseconds;
+		cnt = TCNT0;
+		pending = TIFR0 & _BV(OCF0A);														// compare match happened, but the isr had no chance to count it
+	}
+	if (pending && (cnt < T0_TOP / 2)) ms++;												// counter is already in the next millisecond
+	return ms * 1000 + cnt * T0_TICK_US;
+}
+
+/* compare match B runs at the same position in every millisecond, maintain_alarm() drops the early ones */
+void start_alarm(uint32_t wait_us) {
+	uint16_t tick = TCNT0 + (wait_us % 1000) / T0_TICK_US;
+	OCR0B = (tick > T0_TOP) ? tick - (T0_TOP + 1) : tick;
+	TIFR0 = _BV(OCF0B);																		// drop a match from an earlier alarm
+	TIMSK0 |= _BV(OCIE0B);
+}
+
+void stop_alarm(void) {
+	TIMSK0 &= ~_BV(OCIE0B);
+}
+
+ISR(TIMER0_COMPB_vect) {
+	maintain_alarm();
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- adc functions --------------------------------------------------------------------------------------------------------
+* the adc is auto triggered by the timer0 compare match, so there is one conversion per millisecond without any code in
+* the timer isr. with prescaler 128 a conversion takes 104us, the result is handed over to maintain_adc() in the adc isr.
+*/
+void start_adc(uint8_t pin_def) {
+	if (pin_def < pinC0) return;															// only port C has analog inputs
+	uint8_t channel = pin_def - pinC0;
+
+	ADMUX = _BV(REFS1) | _BV(REFS0) | (channel & 0x07);										// internal 1.1 Volt reference
+	if (channel < 6) DIDR0 |= _BV(channel);													// digital input buffer off, saves power
+	ADCSRB = _BV(ADTS1) | _BV(ADTS0);														// trigger source timer0 compare match A
+	ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIF) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);	// auto trigger, isr, 16 MHz / 128 = 125 kHz
+}
+
+ISR(ADC_vect) {
+	maintain_adc(ADC);
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- twi functions --------------------------------------------------------------------------------------------------------
+* master transmitter only, every bus event raises the twi isr which asks maintain_twi() for the next byte. after the last
+* transfer a stop is sent and the isr stays quiet till start_twi() is called by the next twi_end().
+*/
+void init_twi(uint32_t clock) {
+	set_pin_high(pinC4);																	// internal pullups on sda and scl, same as Wire
+	set_pin_high(pinC5);
+	TWSR = 0;																				// prescaler 1
+	TWBR = ((F_CPU / clock) - 16) / 2;														// 12 at 400 kHz
+	TWCR = _BV(TWEN);
+}
+
+void start_twi(void) {
+	while (TWCR & _BV(TWSTO));																// last stop is still on the bus, some us
+	TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+}
+
+ISR(TWI_vect) {
+	uint8_t status = TW_STATUS;
+	uint8_t ack = (status == TW_START) || (status == TW_REP_START) || (status == TW_MT_SLA_ACK) || (status == TW_MT_DATA_ACK);
+	uint8_t data;
+
+	switch (maintain_twi(ack, &data)) {
+	case TWI_SEND:
+		TWDR = data;
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+		break;
+	case TWI_RESTART:
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTO) | _BV(TWSTA);				// stop, then start of the next transfer
+		break;
+	default:
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);											// stop, no interrupt after it
+	}
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- eeprom functions -----------------------------------------------------------------------------------------------------
+* to make the library more hardware independend all eeprom relevant functions are defined at one point
+*/
+
+/* init the eeprom, can be enriched for a serial eeprom as well */
+void init_eeprom(void) {
+	// place the code to init a i2c eeprom
+}
+
+/* read a specific eeprom address */
+void get_eeprom(uint16_t addr, uint8_t len, void *ptr) {
+	eeprom_read_block((void*)ptr, (const void*)addr, len);									// AVR GCC standard function
+}
+
+/* write a block to a specific eeprom address */
+void set_eeprom(uint16_t addr, uint8_t len, void *ptr) {
+	/* update is much faster, while writes only when needed; needs some byte more space
+	* but otherwise we run in timing issues */
+	eeprom_update_block((const void*)ptr, (void*)addr, len);								// AVR GCC standard function
+}
+
+/* a write is running for 3.4ms, the next access waits for it */
+uint8_t ready_eeprom(void) {
+	return eeprom_is_ready() ? 1 : 0;
+}
+
+/* and clear the eeprom */
+void clear_eeprom(uint16_t addr, uint16_t len) {
+	uint8_t tB = 0;
+	if (!len) return;
+	for (uint16_t l = 0; l < len; l++) {													// step through the bytes of eeprom
+		set_eeprom(addr + l, 1, (void*)&tB);
+	}
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+#endif
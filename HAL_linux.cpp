@@ -0,0 +1,286 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - hardware abstraction, linux host backend ------------------------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+#if !defined(__AVR__)
+
+#include "myfunc.h"
+#include <stdio.h>
+
+
+/*-- arduino core ---------------------------------------------------------------------------------------------------------
+*/
+HostSerial Serial;
+
+size_t HostSerial::write(uint8_t c) {
+	return (fputc(c, stdout) == EOF) ? 0 : 1;
+}
+
+size_t Print::printNumber(unsigned long long n, int base) {
+	char buf[8 * sizeof(n) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+	*str = '\0';
+	if (base < 2) base = DEC;
+	do {
+		uint8_t digit = n % base;
+		*--str = (digit < 10) ? '0' + digit : 'A' + digit - 10;
+		n /= base;
+	} while (n);
+	return write(str);
+}
+
+size_t Print::print(double n, int digits) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%.*f", digits, n);
+	return write(buf);
+}
+
+static uint8_t  sim_pwm[22];																// last analogWrite value per pin
+static uint16_t sim_servo[22];																// last servo pulse width per pin
+static uint16_t sim_adc[22];																// analogRead values per pin
+
+void analogWrite(uint8_t pin, int val) {
+	if (pin < sizeof(sim_pwm) / sizeof(sim_pwm[0])) sim_pwm[pin] = (uint8_t)val;
+}
+int analogRead(uint8_t pin) {
+	return (pin < sizeof(sim_adc) / sizeof(sim_adc[0])) ? sim_adc[pin] : 0;
+}
+void analogReference(uint8_t) {
+}
+
+uint8_t Servo::attach(int pin, int, int) {
+	this->pin = (int8_t)pin;
+	return 1;
+}
+void Servo::writeMicroseconds(int value) {
+	us = value;
+	if ((pin >= 0) && (pin < (int)(sizeof(sim_servo) / sizeof(sim_servo[0])))) sim_servo[pin] = (uint16_t)value;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- simulated ports ------------------------------------------------------------------------------------------------------
+* inputs are idle high as with the pullups enabled by register_PCINT(), a pin change is raised only for pins which are
+* enabled in PCICR and the matching PCMSK register, exactly like the atmega would do it.
+*/
+volatile uint8_t hal_ddr[5], hal_port[5], hal_pin[5];
+volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+
+void hal_sim_set_input(uint8_t pin_def, uint8_t level) {
+	uint8_t port = digitalPinToPort(pin_def);
+	uint8_t bit = digitalPinToBitMask(pin_def);
+	if (port == NOT_A_PIN) return;
+
+	uint8_t old = hal_pin[port];
+	if (level) hal_pin[port] |= bit;
+	else hal_pin[port] &= ~bit;
+	if (old == hal_pin[port]) return;														// no change, no interrupt
+
+	uint8_t vec = digitalPinToPCICRbit(pin_def);
+	if (!(PCICR & _BV(vec))) return;														// vector not enabled
+	if (!(*digitalPinToPCMSK(pin_def) & bit)) return;										// pin not enabled
+	maintain_PCINT(vec);																	// same as the isr on the atmega
+}
+
+uint8_t hal_sim_get_output(uint8_t pin_def) {
+	return (hal_port[digitalPinToPort(pin_def)] & digitalPinToBitMask(pin_def)) ? HIGH : LOW;
+}
+
+uint8_t hal_sim_get_pwm(uint8_t pin_def) {
+	return (pin_def < sizeof(sim_pwm) / sizeof(sim_pwm[0])) ? sim_pwm[pin_def] : 0;
+}
+
+uint16_t hal_sim_servo_us(uint8_t pin_def) {
+	return (pin_def < sizeof(sim_servo) / sizeof(sim_servo[0])) ? sim_servo[pin_def] : 0;
+}
+
+/* the esc ignores frames with a wrong crc, the throttle is stored as the equivalent servo pulse width */
+void hal_sim_dshot(uint8_t pin_def, uint16_t packet) {
+	if (pin_def >= sizeof(sim_servo) / sizeof(sim_servo[0])) return;
+	if (!dshot_check(packet)) return;
+	uint16_t value = packet >> 5;
+	sim_servo[pin_def] = (value < DSHOT_MIN) ? 0 : 1000 + (uint32_t)(value - DSHOT_MIN) * 1000 / (DSHOT_MAX - DSHOT_MIN);
+}
+
+void hal_sim_set_adc(uint8_t pin_def, uint16_t value) {
+	if (pin_def < sizeof(sim_adc) / sizeof(sim_adc[0])) sim_adc[pin_def] = value;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- adc functions --------------------------------------------------------------------------------------------------------
+* the background conversion reads the hal_sim_set_adc() value of the pin once per virtual millisecond.
+*/
+static uint8_t sim_adc_pin = NO_PIN;
+
+void start_adc(uint8_t pin_def) {
+	sim_adc_pin = pin_def;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- twi functions --------------------------------------------------------------------------------------------------------
+* there is no bus, a transfer is done at once. hal_sim_twi_bytes() counts the bytes which went out, addresses included.
+* with hal_sim_twi_hold() set the bus stays busy, the host program calls maintain_twi() itself like the isr does.
+*/
+static uint32_t sim_twi_bytes;
+static uint8_t sim_twi_hold;
+
+void init_twi(uint32_t) {
+}
+
+void start_twi(void) {
+	if (sim_twi_hold) return;
+	uint8_t data;
+	uint8_t next;
+	do {
+		next = maintain_twi(1, &data);
+		if (next == TWI_SEND) sim_twi_bytes++;
+	} while (next != TWI_STOP);
+}
+
+uint32_t hal_sim_twi_bytes(void) {
+	return sim_twi_bytes;
+}
+
+void hal_sim_twi_hold(uint8_t hold) {
+	sim_twi_hold = hold;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- timer functions ------------------------------------------------------------------------------------------------------
+* virtual clock, time only moves forward with hal_sim_advance_us(). the tick hook replaces the timer0 compare isr.
+*/
+volatile uint32_t milliseconds;
+void(*hal_sim_tick_hook)(void);
+static uint64_t sim_micros;
+static uint64_t sim_alarm;																	// 0 while no alarm is pending
+
+void init_millis_timer0() {
+}
+
+uint32_t get_millis(void) {
+	return milliseconds;
+}
+
+uint32_t get_micros(void) {
+	return (uint32_t)sim_micros;
+}
+
+void hal_sim_advance_us(uint32_t us) {
+	uint64_t target = sim_micros + us;
+	while (sim_micros < target) {
+		uint64_t next_ms = (sim_micros / 1000 + 1) * 1000;									// next full millisecond
+		if (sim_alarm && (sim_alarm <= target) && (sim_alarm < next_ms)) {					// compare match of the alarm comes first
+			sim_micros = sim_alarm;
+			sim_alarm = 0;
+			maintain_alarm();
+			continue;
+		}
+		if (next_ms > target) {
+			sim_micros = target;
+			break;
+		}
+		sim_micros = next_ms;
+		++milliseconds;
+		if (hal_sim_tick_hook) hal_sim_tick_hook();
+		if (sim_adc_pin < sizeof(sim_adc) / sizeof(sim_adc[0])) maintain_adc(sim_adc[sim_adc_pin]);	// conversion triggered by the compare match
+	}
+}
+
+/* the deadline is taken directly, maintain_alarm() sees it right on time */
+void start_alarm(uint32_t wait_us) {
+	sim_alarm = sim_micros + wait_us;
+}
+
+void stop_alarm(void) {
+	sim_alarm = 0;
+}
+
+uint64_t hal_sim_micros(void) {
+	return sim_micros;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- eeprom functions -----------------------------------------------------------------------------------------------------
+* plain byte array, erased state is 0xff. with a file set every write is flushed, so settings survive a host restart.
+*/
+static uint8_t sim_eeprom[E2END + 1];
+static const char *sim_eeprom_path;
+
+void hal_sim_eeprom_file(const char *path) {
+	sim_eeprom_path = path;
+	memset(sim_eeprom, 0xff, sizeof(sim_eeprom));
+	FILE *f = fopen(path, "rb");
+	if (!f) return;																			// no file yet, start with an erased eeprom
+	size_t n = fread(sim_eeprom, 1, sizeof(sim_eeprom), f);
+	(void)n;
+	fclose(f);
+}
+
+static void sim_eeprom_flush(void) {
+	if (!sim_eeprom_path) return;
+	FILE *f = fopen(sim_eeprom_path, "wb");
+	if (!f) return;
+	fwrite(sim_eeprom, 1, sizeof(sim_eeprom), f);
+	fclose(f);
+}
+
+void init_eeprom(void) {
+}
+
+void get_eeprom(uint16_t addr, uint8_t len, void *ptr) {
+	if (addr + len > sizeof(sim_eeprom)) return;
+	memcpy(ptr, &sim_eeprom[addr], len);
+}
+
+void set_eeprom(uint16_t addr, uint8_t len, void *ptr) {
+	if (addr + len > sizeof(sim_eeprom)) return;
+	if (!memcmp(&sim_eeprom[addr], ptr, len)) return;										// same as eeprom_update_block, write only on change
+	memcpy(&sim_eeprom[addr], ptr, len);
+	sim_eeprom_flush();
+}
+
+void clear_eeprom(uint16_t addr, uint16_t len) {
+	uint8_t tB = 0;
+	for (uint16_t l = 0; l < len; l++) {
+		set_eeprom(addr + l, 1, (void*)&tB);
+	}
+}
+
+uint8_t ready_eeprom(void) {
+	return 1;																				// writes are done at once
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+void hal_sim_reset(void) {
+	for (uint8_t i = 0; i < 5; i++) {
+		hal_ddr[i] = 0;
+		hal_port[i] = 0;
+		hal_pin[i] = 0xff;
+	}
+	PCICR = PCMSK0 = PCMSK1 = PCMSK2 = 0;
+	memset(sim_pwm, 0, sizeof(sim_pwm));
+	memset(sim_servo, 0, sizeof(sim_servo));
+	memset(sim_adc, 0, sizeof(sim_adc));
+	sim_adc_pin = NO_PIN;
+	sim_twi_bytes = 0;
+	sim_twi_hold = 0;
+	milliseconds = 0;
+	sim_micros = 0;
+	sim_alarm = 0;
+	if (!sim_eeprom_path) memset(sim_eeprom, 0xff, sizeof(sim_eeprom));
+}
+
+/* static initializer, so a host program starts with idle ports and an erased eeprom without calling hal_sim_reset() */
+static struct sim_init { sim_init() { hal_sim_reset(); } } sim_init_instance;
+
+#endif
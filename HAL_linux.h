@@ -0,0 +1,160 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - hardware abstraction, linux host backend ------------------------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+#ifndef _HAL_LINUX_h
+#define _HAL_LINUX_h
+
+/*-- host backend ---------------------------------------------------------------------------------------------------------
+* emulates the part of the arduino core and avr-libc api the sketch is using for an atmega328. ports are plain byte
+* arrays, pin change interrupts are raised by hal_sim_set_input(), time only advances by hal_sim_advance_us() and the
+* eeprom is a byte array which can be backed by a file. there is no main(), a host program drives the classes itself.
+* pusher and launcher are templates in motors.h, the driver only includes it:
+*
+*   g++ -std=gnu++11 -O2 -I. myfunc.cpp HAL_linux.cpp <your_driver>.cpp
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+//- arduino core ----------------------------------------------------------------------------------------------------------
+#define HIGH 1
+#define LOW  0
+#define DEC  10
+#define HEX  16
+#define INTERNAL 3
+#define DEFAULT  1
+#define NOT_A_PIN 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#ifndef _BV
+#define _BV(bit) (1 << (bit))
+#endif
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+/* print class with the overloads the sketch is using, integer overloads cover the host type widths as well */
+class Print {
+public:
+	virtual size_t write(uint8_t) = 0;
+	virtual ~Print() {}
+
+	size_t write(const char *str) { size_t n = 0; while (*str) n += write((uint8_t)*str++); return n; }
+
+	size_t print(const __FlashStringHelper *ifsh) { return write(reinterpret_cast<const char *>(ifsh)); }
+	size_t print(const char str[]) { return write(str); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+	size_t print(signed char n, int base = DEC) { return printSigned(n, base); }
+	size_t print(short n, int base = DEC) { return printSigned(n, base); }
+	size_t print(unsigned short n, int base = DEC) { return printNumber(n, base); }
+	size_t print(int n, int base = DEC) { return printSigned(n, base); }
+	size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+	size_t print(long n, int base = DEC) { return printSigned(n, base); }
+	size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+	size_t print(long long n, int base = DEC) { return printSigned(n, base); }
+	size_t print(unsigned long long n, int base = DEC) { return printNumber(n, base); }
+	size_t print(double n, int digits = 2);
+
+private:
+	size_t printSigned(long long n, int base) {
+		if (n >= 0 || base != DEC) return printNumber((unsigned long long)n, base);
+		return write((uint8_t)'-') + printNumber((unsigned long long)(-n), base);
+	}
+	size_t printNumber(unsigned long long n, int base);
+};
+
+/* serial interface, prints to stdout */
+class HostSerial : public Print {
+public:
+	virtual size_t write(uint8_t c);
+	void begin(unsigned long) {}
+};
+extern HostSerial Serial;
+
+void analogWrite(uint8_t pin, int val);
+int analogRead(uint8_t pin);
+void analogReference(uint8_t mode);
+
+
+//- atmega328 pin tables --------------------------------------------------------------------------------------------------
+/* pin numbers as in myfunc.h: 0 - 7 port D (PCINT2), 8 - 13 port B (PCINT0), 14 - 21 port C (PCINT1) */
+extern volatile uint8_t hal_ddr[5], hal_port[5], hal_pin[5];								// indexed by the arduino port number
+extern volatile uint8_t PCICR, PCMSK0, PCMSK1, PCMSK2;
+#define DDRB  hal_ddr[PB]																	// port registers by name, as used by Pin<>
+#define DDRC  hal_ddr[PC]
+#define DDRD  hal_ddr[PD]
+#define PORTB hal_port[PB]
+#define PORTC hal_port[PC]
+#define PORTD hal_port[PD]
+#define PINB  hal_pin[PB]
+#define PINC  hal_pin[PC]
+#define PIND  hal_pin[PD]
+
+inline uint8_t digitalPinToPort(uint8_t p) { return (p < 8) ? PD : (p < 14) ? PB : (p < 22) ? PC : NOT_A_PIN; }
+inline uint8_t digitalPinToBitMask(uint8_t p) { return _BV((p < 8) ? p : (p < 14) ? p - 8 : p - 14); }
+inline volatile uint8_t *portModeRegister(uint8_t port) { return &hal_ddr[port]; }
+inline volatile uint8_t *portOutputRegister(uint8_t port) { return &hal_port[port]; }
+inline volatile uint8_t *portInputRegister(uint8_t port) { return &hal_pin[port]; }
+
+inline volatile uint8_t *digitalPinToPCICR(uint8_t) { return &PCICR; }
+inline uint8_t digitalPinToPCICRbit(uint8_t p) { return (p < 8) ? 2 : (p < 14) ? 0 : 1; }
+inline volatile uint8_t *digitalPinToPCMSK(uint8_t p) { return (p < 8) ? &PCMSK2 : (p < 14) ? &PCMSK0 : &PCMSK1; }
+inline uint8_t digitalPinToPCMSKbit(uint8_t p) { return (p < 8) ? p : (p < 14) ? p - 8 : p - 14; }
+
+
+//- avr-libc --------------------------------------------------------------------------------------------------------------
+/* the host has no interrupts which could break into the main code, an atomic block is a plain block */
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (uint8_t _atomic_once = 1; _atomic_once; _atomic_once = 0)
+
+#define E2END 0x3FF																			// 1k eeprom as on the atmega328
+
+
+//- servo library ---------------------------------------------------------------------------------------------------------
+/* remembers the last written pulse width, hal_sim_servo_us() returns it per pin */
+class Servo {
+public:
+	uint8_t attach(int pin, int min, int max);
+	void writeMicroseconds(int value);
+	int readMicroseconds() { return us; }
+
+private:
+	int8_t pin = -1;
+	int us = 0;
+};
+
+
+//- simulation api --------------------------------------------------------------------------------------------------------
+void hal_sim_reset(void);																	// all ports idle high, clock and pwm to 0
+void hal_sim_set_input(uint8_t pin_def, uint8_t level);										// drive an input pin, raises the pin change interrupt
+uint8_t hal_sim_get_output(uint8_t pin_def);												// level of an output pin
+uint8_t hal_sim_get_pwm(uint8_t pin_def);													// last analogWrite value of a pin
+uint16_t hal_sim_servo_us(uint8_t pin_def);													// last pulse width written to a servo pin
+void hal_sim_dshot(uint8_t pin_def, uint16_t packet);										// dshot frame sent on a pin, read back by hal_sim_servo_us()
+void hal_sim_set_adc(uint8_t pin_def, uint16_t value);										// value for analogRead() and the background conversion
+uint32_t hal_sim_twi_bytes(void);															// bytes sent on the twi bus since reset
+void hal_sim_twi_hold(uint8_t hold);														// 1 keeps the bus busy, the host calls maintain_twi()
+
+void hal_sim_advance_us(uint32_t us);														// advance the virtual clock, runs the tick hook every ms
+uint64_t hal_sim_micros(void);																// virtual clock in us since reset
+extern void(*hal_sim_tick_hook)(void);														// called every virtual ms, same place as the timer0 isr
+
+void hal_sim_eeprom_file(const char *path);													// load the eeprom from a file and write back on every change
+//- -----------------------------------------------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,213 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - latency and throughput benchmark on top of the blaster simulator ------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+/*-- benchmark ------------------------------------------------------------------------------------------------------------
+* sweeps fire_speed, speedup_time and standby_speed and runs every settings.mode from a stopped launcher and as a follow
+* up shot while the launcher is still in standby. a second table runs unlimited mode against settings.rate and
+* settings.recover, a third one compares the spin-up profiles in time to speed from a stopped launcher, on a fresh pack
+* and on a worn one with an esc which cuts the power on low voltage, with and without its own current limit. the last ones
+* show the first dart latency after a pre-rev, how the standby time adapts to the pause between shots and the flywheel
+* speed over the battery voltage with and without the throttle compensation. build and run from the sketch folder:
+*
+*   g++ -std=gnu++11 -O2 -I. myfunc.cpp HAL_linux.cpp host/sim_blaster.cpp host/bench_blaster.cpp -o bench_blaster
+*   ./bench_blaster
+*/
+
+#include "sim_blaster.h"
+#include <stdio.h>
+#include <time.h>
+
+
+static const uint8_t  fire_speeds[] = { 60, 80, 100 };
+static const uint16_t speedup_times[] = { 200, 300, 400, 500, 600 };
+static const uint8_t  standby_speeds[] = { 30, 50, 70 };
+static const char *mode_names[] = { "unlimited", "single", "double", "tripple" };
+static const uint8_t  rates[] = { 0, 4, 6, 8, 10 };
+static const uint8_t  recovers[] = { 0, 40, 80 };
+static const char *ramp_names[] = { "step", "linear", "s-curve", "current" };
+
+int main() {
+	s_sim_params par;
+	BlasterSim sim(par);
+	uint64_t sim_us = 0;
+	clock_t start = clock();
+
+	printf("mode       fire spdup stby | cold: lat_ms darts  dps  rpm%%  ovr | warm: lat_ms darts  dps  rpm%%  ovr | cycle_ms min_V\n");
+
+	for (uint8_t m = 0; m < 4; m++) {
+		for (uint8_t f = 0; f < sizeof(fire_speeds); f++) {
+			for (uint8_t s = 0; s < sizeof(speedup_times) / sizeof(speedup_times[0]); s++) {
+				for (uint8_t b = 0; b < sizeof(standby_speeds); b++) {
+					sim.mode = m;
+					sim.fire_speed = fire_speeds[f];
+					sim.speedup_time = speedup_times[s];
+					sim.standby_speed = standby_speeds[b];
+					sim.boot();
+
+					uint32_t hold = (m == 0) ? 1500 : speedup_times[s] + 100;				// the launcher goes to standby on release, so hold till the pusher started
+					s_sim_result cold = sim.shot(hold);										// launcher was stopped
+					s_sim_result warm = sim.shot(hold);										// follow up shot, launcher in standby
+					sim_us += hal_sim_micros();
+
+					printf("%-10s %4u %5u %4u |       %6.1f %5u %4.1f %5.1f %4.0f |       %6.1f %5u %4.1f %5.1f %4.0f | %8.1f %5.2f\n",
+						mode_names[m], fire_speeds[f], speedup_times[s], standby_speeds[b],
+						cold.latency_us / 1000.0, cold.darts, cold.darts_per_s, cold.min_dart_rpm, cold.overrun_deg,
+						warm.latency_us / 1000.0, warm.darts, warm.darts_per_s, warm.min_dart_rpm, warm.overrun_deg,
+						cold.cycle_us / 1000.0, cold.min_volt < warm.min_volt ? cold.min_volt : warm.min_volt);
+				}
+			}
+		}
+	}
+
+	printf("\nrate recover | darts   dps  rpm%%  ovr | cycle_ms min_V\n");
+
+	for (uint8_t r = 0; r < sizeof(rates); r++) {
+		for (uint8_t c = 0; c < sizeof(recovers); c++) {
+			sim.mode = 0;
+			sim.fire_speed = 80;
+			sim.speedup_time = 300;
+			sim.standby_speed = 50;
+			sim.rate = rates[r];
+			sim.recover = recovers[c];
+			sim.boot();
+
+			sim.shot(1500);																// first burst finds the pwm for the rate
+			s_sim_result res = sim.shot(1500);
+			sim_us += hal_sim_micros();
+
+			printf("%4u %7u | %5u %5.1f %5.1f %4.0f | %8.1f %5.2f\n", rates[r], recovers[c],
+				res.darts, res.darts_per_s, res.min_dart_rpm, res.overrun_deg, res.cycle_us / 1000.0, res.min_volt);
+		}
+	}
+	sim.rate = 0;
+	sim.recover = 0;
+
+	printf("\npack     ramp    fire | t90_ms t98_ms min_V | lat_ms  rpm%%\n");
+
+	static const char *pack_names[] = { "fresh", "worn", "worn+lim" };
+	for (uint8_t k = 0; k < 3; k++) {
+		s_sim_params rp;																	// fresh pack, plain esc
+		if (k) {																			// worn pack, the esc cuts the power at 3 V per cell
+			rp.bat_volt = 11.4f;
+			rp.bat_res = 0.100f;
+			rp.esc_volt_cut = 9.0f;
+		}
+		if (k == 2) rp.esc_amp_limit = 20;													// and limits the current on its own
+		BlasterSim rs(rp);
+
+		for (uint8_t p = 0; p <= RAMP_PROFILES; p++) {
+			for (uint8_t f = 0; f < sizeof(fire_speeds); f++) {
+				rs.mode = 1;
+				rs.fire_speed = fire_speeds[f];
+				rs.speedup_time = 500;
+				rs.ramp = p;
+
+				/* flywheel speed over one second from a stopped launcher, the last value is the target */
+				static float rpm[1000];
+				rs.boot();
+				rs.trigger(1);
+				float min_volt = rs.battery_volt();
+				for (uint16_t ms = 0; ms < 1000; ms++) {
+					rs.run_us(1000);
+					rpm[ms] = rs.flywheel_rpm();
+					if (rs.battery_volt() < min_volt) min_volt = rs.battery_volt();
+				}
+				rs.trigger(0);
+				sim_us += hal_sim_micros();
+
+				uint16_t t90 = 0, t98 = 0;
+				while ((t90 < 999) && (rpm[t90] < rpm[999] * 0.90f)) t90++;
+				while ((t98 < 999) && (rpm[t98] < rpm[999] * 0.98f)) t98++;
+
+				rs.boot();																	// first dart of a cold shot, the tach decides when the pusher starts
+				s_sim_result res = rs.shot(600);
+				sim_us += hal_sim_micros();
+
+				printf("%-8s %-7s %4u | %6u %6u %5.2f | %6.1f %5.1f\n", pack_names[k], ramp_names[p], fire_speeds[f],
+					t90 + 1, t98 + 1, min_volt, res.latency_us / 1000.0, res.min_dart_rpm);
+			}
+		}
+	}
+
+	printf("\nfire | cold_ms  prerev_ms: 100   300   600\n");
+
+	static const uint16_t prerev_ahead[] = { 100, 300, 600 };
+	for (uint8_t f = 0; f < sizeof(fire_speeds); f++) {
+		sim.mode = 1;
+		sim.fire_speed = fire_speeds[f];
+		sim.speedup_time = 500;
+		sim.boot();
+		s_sim_result cold = sim.shot(600);
+		sim_us += hal_sim_micros();
+		printf("%4u | %7.1f           ", fire_speeds[f], cold.latency_us / 1000.0);
+
+		for (uint8_t a = 0; a < sizeof(prerev_ahead) / sizeof(prerev_ahead[0]); a++) {
+			sim.boot();
+			sim.prerev();																// hint ahead of the trigger press
+			sim.run_us(prerev_ahead[a] * 1000UL);
+			s_sim_result res = sim.shot(600);
+			sim_us += hal_sim_micros();
+			printf(" %5.1f", res.latency_us / 1000.0);
+		}
+		printf("\n");
+	}
+
+	printf("\npause_ms | standby_ms after shot 1   4   8  12 | lat_ms first  last\n");
+
+	static const uint16_t pauses[] = { 300, 900, 1200, 1500, 3000 };
+	for (uint8_t p = 0; p < sizeof(pauses) / sizeof(pauses[0]); p++) {
+		sim.mode = 1;
+		sim.fire_speed = 80;
+		sim.speedup_time = 500;
+		sim.standby_time = 500;
+		sim.boot();
+
+		float first = 0, last = 0;
+		printf("%8u |                    ", pauses[p]);
+		for (uint8_t n = 1; n <= 12; n++) {												// shots with the same pause in between
+			s_sim_result res = sim.shot(600);
+			if (n == 1) first = res.latency_us / 1000.0f;
+			last = res.latency_us / 1000.0f;
+			if ((n == 1) || (n == 4) || (n == 8) || (n == 12)) printf(" %4u", sim.get_launcher()->standby());
+			sim.run_us(pauses[p] * 1000UL);
+		}
+		sim_us += hal_sim_micros();
+		printf(" |       %5.1f %5.1f\n", first, last);
+	}
+
+	printf("\nbattery_V | flywheel rpm%%, dart rpm%%: plain        compensated\n");
+
+	static const float bat_volts[] = { 12.6f, 12.0f, 11.4f, 10.8f };
+	for (uint8_t v = 0; v < sizeof(bat_volts) / sizeof(bat_volts[0]); v++) {
+		printf("%9.1f |                          ", bat_volts[v]);
+		for (uint8_t c = 0; c < 2; c++) {
+			s_sim_params vp;
+			vp.bat_volt = bat_volts[v];
+			BlasterSim vs(vp);
+			vs.mode = 1;
+			vs.fire_speed = 80;
+			vs.speedup_time = 500;
+			vs.compensate = c;
+			vs.boot();
+			s_sim_result res = vs.shot(1000);										// launcher settles after the dart till the release
+			vs.trigger(1);
+			vs.run_us(1000000);
+			float rpm = vs.flywheel_rpm() * 100 / (80 / 100.0f * vp.fly_rpm_max);
+			vs.trigger(0);
+			vs.run_us(1000000);
+			sim_us += hal_sim_micros();
+			printf("  %5.1f %5.1f     ", rpm, res.min_dart_rpm);
+		}
+		printf("\n");
+	}
+
+	double wall = (double)(clock() - start) / CLOCKS_PER_SEC;
+	printf("\nsimulated %.1f s in %.2f s wall time, %.2f M steps/s\n", sim_us / 1e6, wall, sim_us / par.step_us / 1e6 / wall);
+	return 0;
+}
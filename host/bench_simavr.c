@@ -0,0 +1,201 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - cycle accurate isr and loop benchmark of the avr firmware under simavr ------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+/*-- benchmark ------------------------------------------------------------------------------------------------------------
+* runs the real firmware, built with -DPROFILE, on a simulated atmega328p. the firmware writes its markers (see profiling
+* in myfunc.h) to GPIOR0, here every write is stamped with the cycle counter. pin stimuli are played from a script, the
+* delay between a stimulus and the matching pin change isr entry is the interrupt latency.
+*
+*   arduino-cli compile -b arduino:avr:nano --build-property build.extra_flags=-DPROFILE --output-dir build .
+*   gcc -O2 host/bench_simavr.c -lsimavr -lelf -o bench_simavr
+*   ./bench_simavr build/FDL-2_Arduino.ino.elf
+*
+* timer0 isr cost is measured between the markers, so the prologue and epilogue (about 40 cycles with encoder.service()
+* inlined) is part of the latency figures but not of the isr figures.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/avr_ioport.h>
+
+#define F_CPU         16000000
+#define GPIOR0_ADDR   0x3E																	// data space address of GPIOR0
+#define CYCLES_MS     (F_CPU / 1000)
+
+/* same values as in myfunc.h */
+#define PROF_T0_ENTER     0x10
+#define PROF_T0_EXIT      0x11
+#define PROF_PCINT_ENTER  0x20
+#define PROF_PCINT_EXIT   0x28
+#define PROF_HOOK_ENTER   0x30
+#define PROF_HOOK_EXIT    0x31
+#define PROF_LOOP         0x40
+
+
+/*-- stimulus script ------------------------------------------------------------------------------------------------------
+* fire button D5, front sensor D7, back sensor D6, encoder button C2. all low active with pullup, idle is high.
+* while the trigger is held the sensors toggle like a pusher disc at 12 turns per second.
+*/
+struct s_stim {
+	uint32_t ms;
+	char port;
+	uint8_t bit;
+	uint8_t level;
+};
+
+#define MAX_STIM 512
+static struct s_stim script[MAX_STIM];
+static int script_len;
+
+static void stim(uint32_t ms, char port, uint8_t bit, uint8_t level) {
+	if (script_len >= MAX_STIM) return;
+	script[script_len].ms = ms;
+	script[script_len].port = port;
+	script[script_len].bit = bit;
+	script[script_len].level = level;
+	script_len++;
+}
+
+static void build_script(void) {
+	stim(0, 'D', 5, 1);																		// idle levels
+	stim(0, 'D', 7, 1);
+	stim(0, 'D', 6, 0);																		// pusher rests on the back sensor
+	stim(0, 'C', 2, 1);
+
+	for (uint32_t shot = 0; shot < 5; shot++) {
+		uint32_t t = 1000 + shot * 1500;
+		stim(t, 'D', 5, 0);																	// trigger press
+		for (uint32_t rev = 0; rev < 6; rev++) {											// pusher turns after the speedup time
+			uint32_t r = t + 500 + rev * 83;
+			stim(r + 3, 'D', 6, 1);															// leave back sensor
+			stim(r + 38, 'D', 7, 0);														// front sensor, dart
+			stim(r + 45, 'D', 7, 1);
+			stim(r + 80, 'D', 6, 0);														// back sensor
+		}
+		stim(t + 1100, 'D', 5, 1);															// trigger release
+		stim(t + 1200, 'C', 2, 0);															// encoder click
+		stim(t + 1350, 'C', 2, 1);
+	}
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- marker statistics ----------------------------------------------------------------------------------------------------
+*/
+struct s_stat {
+	const char *name;
+	uint32_t count;
+	uint64_t sum;
+	uint32_t min;
+	uint32_t max;
+};
+
+static void stat_add(struct s_stat *s, uint32_t v) {
+	if (!s->count || v < s->min) s->min = v;
+	if (v > s->max) s->max = v;
+	s->sum += v;
+	s->count++;
+}
+
+static void stat_print(struct s_stat *s) {
+	if (!s->count) {
+		printf("%-22s     no samples\n", s->name);
+		return;
+	}
+	printf("%-22s %8u %8u %8u %10.1f %8.2f\n", s->name, s->count, s->min, s->max, (double)s->sum / s->count, s->max / (F_CPU / 1e6));
+}
+
+static struct s_stat st_t0 = { "timer0 isr" };
+static struct s_stat st_pcint = { "pcint isr" };
+static struct s_stat st_hook = { "pcint handler" };
+static struct s_stat st_lat = { "pcint latency" };
+static struct s_stat st_loop = { "loop pass" };
+
+static uint64_t t0_enter, pcint_enter, hook_enter, loop_last;
+static uint64_t stim_pending[3];															// cycle of the oldest unserved stimulus per pcint vector
+
+static void marker_write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+	uint64_t c = avr->cycle;
+	(void)addr;
+	(void)param;
+
+	if (v == PROF_T0_ENTER) t0_enter = c;
+	else if (v == PROF_T0_EXIT) stat_add(&st_t0, (uint32_t)(c - t0_enter));
+	else if ((v & 0xf8) == PROF_PCINT_ENTER) {
+		pcint_enter = c;
+		uint8_t vec = v & 0x07;
+		if ((vec < 3) && stim_pending[vec]) {
+			stat_add(&st_lat, (uint32_t)(c - stim_pending[vec]));
+			stim_pending[vec] = 0;
+		}
+	}
+	else if ((v & 0xf8) == PROF_PCINT_EXIT) stat_add(&st_pcint, (uint32_t)(c - pcint_enter));
+	else if (v == PROF_HOOK_ENTER) hook_enter = c;
+	else if (v == PROF_HOOK_EXIT) stat_add(&st_hook, (uint32_t)(c - hook_enter));
+	else if (v == PROF_LOOP) {
+		if (loop_last) stat_add(&st_loop, (uint32_t)(c - loop_last));
+		loop_last = c;
+	}
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s firmware.elf\n", argv[0]);
+		return 1;
+	}
+
+	elf_firmware_t fw;
+	memset(&fw, 0, sizeof(fw));
+	if (elf_read_firmware(argv[1], &fw)) {
+		fprintf(stderr, "can't read %s\n", argv[1]);
+		return 1;
+	}
+
+	avr_t *avr = avr_make_mcu_by_name("atmega328p");
+	if (!avr) return 1;
+	avr_init(avr);
+	avr->frequency = F_CPU;
+	avr_load_firmware(avr, &fw);
+	avr_register_io_write(avr, GPIOR0_ADDR, marker_write, NULL);
+
+	build_script();
+	uint64_t end = (uint64_t)(script[script_len - 1].ms + 500) * CYCLES_MS;
+	int next = 0;
+	int state = cpu_Running;
+
+	while ((avr->cycle < end) && (state != cpu_Done) && (state != cpu_Crashed)) {
+		while ((next < script_len) && (avr->cycle >= (uint64_t)script[next].ms * CYCLES_MS)) {
+			struct s_stim *s = &script[next++];
+			avr_irq_t *irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(s->port), s->bit);
+			uint8_t vec = (s->port == 'B') ? 0 : (s->port == 'C') ? 1 : 2;
+			if (s->ms && !stim_pending[vec]) stim_pending[vec] = avr->cycle;
+			avr_raise_irq(irq, s->level);
+		}
+		state = avr_run(avr);
+	}
+
+	printf("simulated %.1f ms, %d stimuli\n\n", avr->cycle / (double)CYCLES_MS, script_len);
+	printf("%-22s %8s %8s %8s %10s %8s\n", "cycles", "count", "min", "max", "avg", "max_us");
+	stat_print(&st_t0);
+	stat_print(&st_pcint);
+	stat_print(&st_hook);
+	stat_print(&st_lat);
+	stat_print(&st_loop);
+	if (st_loop.count) printf("\nloop jitter %u cycles (%.1f us)\n", st_loop.max - st_loop.min, (st_loop.max - st_loop.min) / (F_CPU / 1e6));
+	if (st_t0.count) printf("timer0 isr rate %.0f per second\n", st_t0.count / (avr->cycle / (double)F_CPU));
+
+	avr_terminate(avr);
+	return 0;
+}
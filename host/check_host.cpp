@@ -0,0 +1,655 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - host checks of the hardware independent functions ---------------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+/*-- host checks ----------------------------------------------------------------------------------------------------------
+* runs the hardware independent parts of myfunc on the linux HAL and compares them with known results. every failed
+* check prints a line, the exit code is 1 if anything failed, so a script can stop on it. build and run from the sketch
+* folder:
+*
+*   g++ -std=gnu++11 -O2 -I. myfunc.cpp HAL_linux.cpp host/check_host.cpp -o check_host
+*   ./check_host
+*/
+
+#include "../myfunc.h"
+#include <stdio.h>
+#include <string.h>
+
+
+static uint16_t checks, failed;
+
+static void check(const char *what, uint32_t got, uint32_t want) {
+	checks++;
+	if (got == want) return;
+	failed++;
+	printf("FAIL %s: got 0x%lx, want 0x%lx\n", what, (unsigned long)got, (unsigned long)want);
+}
+
+
+/*-- dshot ----------------------------------------------------------------------------------------------------------------
+* frames worked out by hand: value shifted left by one, the telemetry bit, then the xor of the three nibbles as crc.
+* the simulator checks the frames with dshot_check(), which shares the crc formula, so only these catch a wrong one.
+*/
+static const struct { uint16_t value; uint8_t telemetry; uint16_t frame; } dshot_ref[] = {
+	{    0, 0, 0x0000 }, {    0, 1, 0x0011 },
+	{   48, 0, 0x0606 }, {   48, 1, 0x0617 },
+	{ 1046, 0, 0x82c6 }, { 1046, 1, 0x82d7 },
+	{ 2047, 0, 0xffee }, { 2047, 1, 0xffff },
+};
+
+static void check_dshot() {
+	char what[48];
+	for (uint8_t i = 0; i < sizeof(dshot_ref) / sizeof(dshot_ref[0]); i++) {
+		snprintf(what, sizeof(what), "dshot_packet(%u, %u)", dshot_ref[i].value, dshot_ref[i].telemetry);
+		check(what, dshot_packet(dshot_ref[i].value, dshot_ref[i].telemetry), dshot_ref[i].frame);
+
+		snprintf(what, sizeof(what), "dshot_check(0x%04x)", dshot_ref[i].frame);
+		check(what, dshot_check(dshot_ref[i].frame), 1);
+		for (uint8_t bit = 0; bit < 16; bit++) {											// a single flipped bit never passes
+			snprintf(what, sizeof(what), "dshot_check(0x%04x)", dshot_ref[i].frame ^ (1 << bit));
+			check(what, dshot_check(dshot_ref[i].frame ^ (1 << bit)), 0);
+		}
+	}
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- task scheduler -------------------------------------------------------------------------------------------------------
+* every task writes its letter into the log, a background task works as long as its counter is not used up. the tasks
+* are added out of order, so run() has to see them sorted by priority, same priorities in the order of add().
+*/
+static char task_log[64];
+static uint8_t task_pos, work_a, work_b;
+
+static void task_mark(char c) {
+	if (task_pos < sizeof(task_log) - 1) task_log[task_pos++] = c;
+	task_log[task_pos] = 0;
+}
+static uint8_t task_f(void) { task_mark('f'); return 1; }
+static uint8_t task_g(void) { task_mark('g'); return 0; }
+static uint8_t task_a(void) { task_mark('a'); if (!work_a) return 0; work_a--; return 1; }
+static uint8_t task_b(void) { task_mark('b'); if (!work_b) return 0; work_b--; return 1; }
+
+static void check_tasks() {
+	static taskscheduler sched;																// static, so it starts empty like the global one
+	sched.add(task_b, 2, 0);
+	sched.add(task_f, 0, 0);
+	sched.add(task_a, 1, 0);
+	sched.add(task_g, 0, 0);
+	for (uint8_t i = 4; i <= MAX_TASKS; i++) sched.add(task_b, 3, 0);						// fills the table, the last one is dropped
+
+	work_a = 2;
+	work_b = 1;
+	for (uint8_t pass = 0; pass < 5; pass++) {
+		task_mark('|');
+		sched.run();
+	}
+	/* a works in the first two passes, then b once, then every background task finds nothing to do */
+	const char *want = "|fga|fga|fgab|fgabbbbb|fgabbbbb";
+	check("task order", strcmp(task_log, want), 0);
+	if (strcmp(task_log, want)) printf("     got %s\n     want %s\n", task_log, want);
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- timer service ------------------------------------------------------------------------------------------------------
+* callback timers log their letter and the time they were seen, the queue is polled every 10 us like a busy main loop.
+* no timer may come before its deadline or more than one poll late, whatever order they were armed in, also when the
+* deadlines lie across the wrap of the 32 bit us clock.
+*/
+struct s_tmr {
+	waittimer t;
+	char     id;
+	uint32_t want, at;
+	uint8_t  again;																			// re-arms itself from the callback that often
+};
+static char tmr_log[32];
+static uint8_t tmr_pos;
+
+static void tmr_cb(void *arg) {
+	s_tmr *m = (s_tmr*)arg;
+	if (tmr_pos < sizeof(tmr_log) - 1) tmr_log[tmr_pos++] = m->id;
+	tmr_log[tmr_pos] = 0;
+	m->at = get_micros();
+	if (!m->again) return;
+	m->again--;
+	m->want = get_micros() + 250;
+	m->t.set_us(250);
+}
+
+static void tmr_arm(s_tmr &m, char id, uint32_t us, uint8_t again = 0) {
+	m.id = id;
+	m.again = again;
+	m.at = 0;
+	m.want = get_micros() + us;
+	m.t.set_callback(tmr_cb, &m);
+	m.t.set_us(us);
+}
+
+static void tmr_run(uint32_t us) {
+	for (uint32_t i = 0; i < us; i += 10) {
+		hal_sim_advance_us(10);
+		timers.poll();
+	}
+}
+
+static void tmr_check(const char *what, const char *want, s_tmr *m, uint8_t cnt) {
+	check(what, strcmp(tmr_log, want), 0);
+	if (strcmp(tmr_log, want)) printf("     got %s\n     want %s\n", tmr_log, want);
+	for (uint8_t i = 0; i < cnt; i++) {
+		char late[48];
+		snprintf(late, sizeof(late), "%s, timer %c on time", what, m[i].id);
+		check(late, ((int32_t)(m[i].at - m[i].want) >= 0) && ((int32_t)(m[i].at - m[i].want) < 10), 1);
+	}
+	tmr_pos = 0;
+	tmr_log[0] = 0;
+}
+
+static void check_timers() {
+	static s_tmr m[5];
+	hal_sim_reset();
+
+	/* armed out of order, the queue sorts them */
+	tmr_arm(m[0], 'c', 300);
+	tmr_arm(m[1], 'a', 100);
+	tmr_arm(m[2], 'e', 500);
+	tmr_arm(m[3], 'b', 200);
+	tmr_arm(m[4], 'd', 400);
+	tmr_run(1000);
+	tmr_check("timer order", "abcde", m, 5);
+
+	/* a callback arms its own timer again */
+	tmr_arm(m[0], 'r', 250, 3);
+	tmr_arm(m[1], 'x', 600);
+	tmr_run(2000);
+	tmr_check("timer re-armed in the callback", "rrxrr", m, 2);
+
+	/* a removed timer never comes, a set() of a queued one moves it */
+	tmr_arm(m[0], 'a', 100);
+	tmr_arm(m[1], 'b', 200);
+	tmr_arm(m[2], 'c', 300);
+	tmr_arm(m[3], 'd', 100);
+	timers.remove(&m[1].t);
+	m[3].want = get_micros() + 400;
+	m[3].t.set_us(400);
+	tmr_run(1000);
+	tmr_check("timer removed from the queue", "acd", m + 2, 2);
+	check("removed timer not called", m[1].at, 0);
+	{
+		s_tmr gone;																			// queued while it goes out of scope
+		tmr_arm(gone, 'g', 100);
+	}
+	tmr_arm(m[0], 'a', 200);
+	tmr_run(1000);
+	tmr_check("timer destroyed while queued", "a", m, 1);
+
+	/* polled timer, done() only once and only after the deadline was seen */
+	waittimer p;
+	check("done() of a timer never set", p.done(), 1);
+	p.set_us(300);
+	tmr_run(290);
+	check("done() before the deadline", p.done(), 0);
+	check("completed() before the deadline", p.completed(), 2);
+	tmr_run(20);
+	check("completed() after the deadline", p.completed(), 1);
+	check("done() after the deadline", p.done(), 1);
+	check("done() a second time", p.done(), 1);
+	check("completed() after done()", p.completed(), 0);
+
+	/* deadlines across the wrap of the us clock */
+	hal_sim_advance_us(0xffffffff - get_micros() - 250);
+	tmr_arm(m[0], 'c', 600);
+	tmr_arm(m[1], 'a', 100);
+	tmr_arm(m[2], 'b', 400);
+	p.set_us(350);
+	tmr_run(300);
+	check("done() before the deadline across the wrap", p.done(), 0);
+	tmr_run(1000);
+	check("us clock wrapped", (hal_sim_micros() > 0xffffffffULL), 1);
+	tmr_check("timer order across the wrap", "abc", m, 3);
+	check("done() after the deadline across the wrap", p.done(), 1);
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- pin change -----------------------------------------------------------------------------------------------------------
+* the handlers log pin, level and time of every edge they see. the first edge counts at once, changes within the lockout
+* are ignored by the isr, a level which is different once the lockout is over comes as an edge from check_PCINT() or,
+* with the next change, as the lost edge plus the new one from maintain_PCINT().
+*/
+#define PC_PIN_A 4																			// port d, pin change vector 2
+#define PC_PIN_B 5																			// port d as well
+#define PC_PIN_C 8																			// port b, pin change vector 0
+#define PC_LOCK  5000
+
+struct s_edge {
+	uint8_t  pin, level;
+	uint32_t time;
+};
+static s_edge edge_log[8];
+static uint8_t edge_cnt;
+
+static void edge_cb(void *, uint8_t pin_def, uint8_t level, uint32_t time) {
+	if (edge_cnt < sizeof(edge_log) / sizeof(edge_log[0])) edge_log[edge_cnt] = { pin_def, level, time };
+	edge_cnt++;
+}
+
+static void edge_check(const char *what, uint8_t idx, uint8_t pin, uint8_t level, uint32_t time) {
+	char each[64];
+	snprintf(each, sizeof(each), "%s, edge %u pin", what, idx);
+	check(each, edge_log[idx].pin, pin);
+	snprintf(each, sizeof(each), "%s, edge %u level", what, idx);
+	check(each, edge_log[idx].level, level);
+	snprintf(each, sizeof(each), "%s, edge %u time", what, idx);
+	check(each, edge_log[idx].time, time);
+}
+
+static void pcint_drain(void) {
+	s_pcint_event ev;
+	while (get_PCINT_event(&ev));
+}
+
+static void check_pcint_lockout() {
+	hal_sim_reset();																		// all inputs idle high
+	hal_sim_advance_us(10000);
+	subscribe_PCINT(PC_PIN_A, edge_cb, 0, PC_LOCK);
+	pcint_drain();
+	check("edges at registration", edge_cnt, 0);
+	check("check_PCINT() at registration", check_PCINT(PC_PIN_A, 1), 1);
+
+	/* leading edge at once, the bounce behind it is ignored */
+	hal_sim_advance_us(100);
+	uint32_t t0 = get_micros();
+	hal_sim_set_input(PC_PIN_A, 0);
+	check("leading edge", edge_cnt, 1);
+	edge_check("leading edge", 0, PC_PIN_A, 0, t0);
+	check("get_PCINT_time() of the leading edge", get_PCINT_time(PC_PIN_A), t0);
+	for (uint8_t i = 0; i < 6; i++) {
+		hal_sim_advance_us(40);
+		hal_sim_set_input(PC_PIN_A, i & 1);
+	}
+	check("bounce in the lockout", edge_cnt, 1);
+	check("check_PCINT() of the leading edge", check_PCINT(PC_PIN_A, 1), 2);
+	check("check_PCINT() after the bounce", check_PCINT(PC_PIN_A, 1), 0);
+
+	/* released within the lockout, check_PCINT() takes the level once the lockout is over */
+	hal_sim_advance_us(100);
+	hal_sim_set_input(PC_PIN_A, 1);
+	check("release in the lockout", edge_cnt, 1);
+	check("check_PCINT() in the lockout", check_PCINT(PC_PIN_A, 1), 0);
+	hal_sim_advance_us(t0 + PC_LOCK - get_micros());
+	uint32_t t1 = get_micros();
+	check("check_PCINT() after the lockout", check_PCINT(PC_PIN_A, 1), 3);
+	check("caught up release", edge_cnt, 2);
+	edge_check("caught up release", 1, PC_PIN_A, 1, t1);
+	check("check_PCINT() after the catch up", check_PCINT(PC_PIN_A, 1), 1);
+
+	/* pressed within the lockout and no check_PCINT(), the next change brings the lost edge and its own */
+	hal_sim_advance_us(1000);
+	hal_sim_set_input(PC_PIN_A, 0);
+	check("press in the lockout", edge_cnt, 2);
+	hal_sim_advance_us(PC_LOCK);
+	uint32_t t2 = get_micros();
+	hal_sim_set_input(PC_PIN_A, 1);
+	check("lost press and release", edge_cnt, 4);
+	edge_check("lost press", 2, PC_PIN_A, 0, t2);
+	edge_check("release after the lost press", 3, PC_PIN_A, 1, t2);
+	check("check_PCINT() after the lost press", check_PCINT(PC_PIN_A, 1), 3);
+
+	/* without debounce check_PCINT() takes a changed level at once */
+	hal_sim_advance_us(PC_LOCK);
+	hal_sim_set_input(PC_PIN_A, 0);
+	check_PCINT(PC_PIN_A, 1);
+	hal_sim_advance_us(100);
+	hal_sim_set_input(PC_PIN_A, 1);
+	check("check_PCINT() with debounce in the lockout", check_PCINT(PC_PIN_A, 1), 0);
+	check("check_PCINT() without debounce in the lockout", check_PCINT(PC_PIN_A, 0), 3);
+	pcint_drain();
+	edge_cnt = 0;
+}
+
+/* every change goes into the event ring, bounces in the lockout as well. a full ring drops the newest and counts it */
+static void check_pcint_events() {
+	s_pcint_event ev;
+	char what[48];
+	uint8_t lost = get_PCINT_lost();
+	uint32_t t0 = get_micros();
+
+	for (uint8_t i = 0; i < PCINT_EVENTS + 4; i++) {										// toggles without draining
+		hal_sim_advance_us(10);
+		hal_sim_set_input(PC_PIN_A, i & 1);
+	}
+	check("get_PCINT_lost() of a full ring", (uint8_t)(get_PCINT_lost() - lost), 5);		// one slot stays free
+	for (uint8_t i = 0; i < PCINT_EVENTS - 1; i++) {										// the oldest ones are kept, in order
+		snprintf(what, sizeof(what), "event %u of a full ring", i);
+		check(what, get_PCINT_event(&ev), 1);
+		check(what, ev.vec, 2);
+		check(what, ev.chng, 1 << PC_PIN_A);
+		check(what, (ev.level >> PC_PIN_A) & 1, i & 1);
+		check(what, ev.time, t0 + (i + 1) * 10);
+	}
+	check("event behind a full ring", get_PCINT_event(&ev), 0);
+
+	hal_sim_advance_us(10);																	// drained, the next change goes in again
+	hal_sim_set_input(PC_PIN_A, 0);
+	check("event after the drain", get_PCINT_event(&ev), 1);
+	check("event after the drain", ev.time, get_micros());
+	check("get_PCINT_lost() after the drain", (uint8_t)(get_PCINT_lost() - lost), 5);
+	hal_sim_set_input(PC_PIN_A, 0);
+	check("event of an unchanged pin", get_PCINT_event(&ev), 0);
+
+	hal_sim_advance_us(PC_LOCK);															// back to idle high for the next checks
+	hal_sim_set_input(PC_PIN_A, 1);
+	check_PCINT(PC_PIN_A, 1);
+	pcint_drain();
+	edge_cnt = 0;
+}
+
+/* two pins on one vector, every handler gets the edges of its own pin with its own obj, one event for both */
+static void *edge_obj;
+
+static void edge_obj_cb(void *obj, uint8_t pin_def, uint8_t level, uint32_t time) {
+	edge_obj = obj;
+	edge_cb(obj, pin_def, level, time);
+}
+
+static void check_pcint_dispatch() {
+	static uint8_t obj_b;
+	s_pcint_event ev;
+	subscribe_PCINT(PC_PIN_B, edge_obj_cb, &obj_b, PC_LOCK);
+	subscribe_PCINT(PC_PIN_C, edge_cb, 0, PC_LOCK);
+	pcint_drain();
+	check("edges at a second registration", edge_cnt, 0);
+
+	hal_sim_advance_us(100);
+	hal_sim_set_input(PC_PIN_B, 0);
+	check("edge of pin b", edge_cnt, 1);
+	edge_check("edge of pin b", 0, PC_PIN_B, 0, get_micros());
+	check("obj of pin b", (edge_obj == &obj_b), 1);
+	check("check_PCINT() of pin a while pin b changed", check_PCINT(PC_PIN_A, 1), 1);
+	check("check_PCINT() of pin b", check_PCINT(PC_PIN_B, 1), 2);
+	check("event of pin b", get_PCINT_event(&ev), 1);
+	check("event of pin b", ev.chng, 1 << PC_PIN_B);
+
+	hal_sim_advance_us(100);																// pin c on another vector, pin b in its lockout
+	hal_sim_set_input(PC_PIN_C, 0);
+	check("edge of pin c", edge_cnt, 2);
+	edge_check("edge of pin c", 1, PC_PIN_C, 0, get_micros());
+	check("event of pin c", get_PCINT_event(&ev), 1);
+	check("event of pin c", ev.vec, 0);
+	check("event of pin c", ev.chng, 1 << (PC_PIN_C - 8));
+
+	/* pin a and b change at the same time, one isr */
+	hal_sim_advance_us(PC_LOCK);
+	edge_cnt = 0;
+	pcint_drain();
+	PIND ^= (1 << PC_PIN_A) | (1 << PC_PIN_B);
+	maintain_PCINT(2);
+	check("edges of pin a and b at once", edge_cnt, 2);
+	edge_check("edges of pin a and b at once", 0, PC_PIN_A, 0, get_micros());
+	edge_check("edges of pin a and b at once", 1, PC_PIN_B, 1, get_micros());
+	check("event of pin a and b at once", get_PCINT_event(&ev), 1);
+	check("event of pin a and b at once", ev.chng, (1 << PC_PIN_A) | (1 << PC_PIN_B));
+	check("event of pin a and b at once", ev.level & ((1 << PC_PIN_A) | (1 << PC_PIN_B)), 1 << PC_PIN_B);
+	check("events of pin a and b at once", get_PCINT_event(&ev), 0);
+
+	/* without a handler the edges are still taken for check_PCINT() */
+	subscribe_PCINT(PC_PIN_B, 0);
+	hal_sim_advance_us(PC_LOCK);
+	edge_cnt = 0;
+	hal_sim_set_input(PC_PIN_B, 0);
+	check("edge of pin b without a handler", edge_cnt, 0);
+	check("check_PCINT() of pin b without a handler", check_PCINT(PC_PIN_B, 1), 2);
+	hal_sim_set_input(PC_PIN_A, 1);
+	check("edge of pin a next to pin b without a handler", edge_cnt, 1);
+	pcint_drain();
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- journal ------------------------------------------------------------------------------------------------------------
+* a small ring of 5 slots, so a few hundred records go round it many times and the sequence byte wraps as well. every
+* record is written with poll() like the settings task does it, a torn record is one with poll() stopped midway.
+*/
+#define J_START 64
+#define J_SLOTS 5
+
+struct s_jdata {
+	uint16_t count;
+	uint8_t  fill[6];
+};
+
+static void journal_write(journal &j, const s_jdata &d, uint8_t version, uint8_t bytes = 0xff) {
+	j.save(&d, sizeof(d), version);
+	for (uint8_t i = 0; (i < bytes) && (j.poll()); i++);									// bytes written before the power is gone
+}
+
+static void check_journal() {
+	hal_sim_reset();																		// erased eeprom
+	s_jdata d, got;
+	char what[48];
+
+	journal empty(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	check("load() of an erased journal", empty.load(&got, sizeof(got)), 0);
+
+	/* wrap, the newest record wins, no matter where the ring stands */
+	for (uint16_t n = 1; n <= 300; n++) {
+		journal j(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+		j.load(&got, sizeof(got));
+		memset(&d, n, sizeof(d));
+		d.count = n;
+		journal_write(j, d, 1);
+
+		journal r(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+		memset(&got, 0, sizeof(got));
+		snprintf(what, sizeof(what), "load() after record %u", n);
+		check(what, r.load(&got, sizeof(got)), 1);
+		check(what, got.count, n);
+		check(what, memcmp(&got, &d, sizeof(d)), 0);
+	}
+	for (uint8_t i = 0; i < J_SLOTS; i++) {													// all slots in use, the writes are spread
+		uint8_t seq;
+		get_eeprom(J_START + i * JOURNAL_SLOT, 1, &seq);
+		snprintf(what, sizeof(what), "sequence of slot %u", i);
+		check(what, seq, (uint8_t)(300 - (300 - 1 - i) % J_SLOTS - 1));
+	}
+
+	/* same data again is no new record */
+	journal same(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	same.load(&got, sizeof(got));
+	same.save(&got, sizeof(got), 1);
+	check("save() of unchanged data", same.pending(), 0);
+
+	/* torn record, the power is gone after some bytes, the sequence byte is not written yet */
+	for (uint8_t bytes = 0; bytes < sizeof(d) + 3; bytes++) {
+		journal j(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+		j.load(&got, sizeof(got));
+		memset(&d, 0xa5, sizeof(d));
+		d.count = 1000 + bytes;
+		journal_write(j, d, 1, bytes);
+
+		journal r(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+		snprintf(what, sizeof(what), "load() after %u bytes of a record", bytes);
+		check(what, r.load(&got, sizeof(got)), 1);
+		check(what, got.count, 300);
+	}
+
+	/* broken crc of the newest record, the one before it is taken */
+	journal j(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	j.load(&got, sizeof(got));
+	d.count = 2000;
+	journal_write(j, d, 1);
+	journal c(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	c.load(&got, sizeof(got));
+	check("load() of a new record", got.count, 2000);
+	for (uint8_t i = 0; i < J_SLOTS; i++) {													// flip a data byte of the newest record
+		uint8_t seq, b;
+		uint16_t addr = J_START + i * JOURNAL_SLOT;
+		get_eeprom(addr, 1, &seq);
+		if (seq != (uint8_t)300) continue;													// record 2000 is the 301st, sequences start at 0
+		get_eeprom(addr + 3, 1, &b);
+		b ^= 0x10;
+		set_eeprom(addr + 3, 1, &b);
+	}
+	journal r(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	check("load() with a broken crc", r.load(&got, sizeof(got)), 1);
+	check("load() with a broken crc", got.count, 300);
+
+	/* version and a shorter record, the fields behind it keep what data had */
+	uint8_t part[2] = { 0x34, 0x12 };
+	r.save(part, sizeof(part), 7);
+	while (r.poll());
+	journal v(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	memset(&got, 0x5a, sizeof(got));
+	check("load() of a version 7 record", v.load(&got, sizeof(got)), 7);
+	check("load() of a shorter record", got.count, 0x1234);
+	check("load() of a shorter record", got.fill[0], 0x5a);
+}
+
+/* the fixed settings blocks at address 0 up to magic 0x1238, same as in the sketch */
+static const s_journal_block old_blocks[] = { { 0x1236, 7 }, { 0x1237, 9 }, { 0x1238, 10 } };
+
+static void check_adopt() {
+	static const uint16_t magics[] = { 0x1236, 0x1237, 0x1238, 0x1239, 0xffff };
+	static const uint8_t lens[] = { 7, 9, 10, 0, 0 };
+	uint8_t block[12], data[14];
+	char what[48];
+
+	for (uint8_t m = 0; m < sizeof(magics) / sizeof(magics[0]); m++) {
+		hal_sim_reset();
+		for (uint8_t i = 0; i < sizeof(block); i++) block[i] = 0x10 + i;
+		set_eeprom(0, 2, (void*)&magics[m]);
+		set_eeprom(2, sizeof(block), block);
+
+		journal j(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+		memset(data, 0xee, sizeof(data));
+		snprintf(what, sizeof(what), "adopt() of magic 0x%04x", magics[m]);
+		check(what, j.adopt(0, old_blocks, 3, data, sizeof(data)), lens[m]);
+		for (uint8_t i = 0; i < sizeof(data); i++) {										// block copied, the rest untouched
+			snprintf(what, sizeof(what), "adopt() of magic 0x%04x, byte %u", magics[m], i);
+			check(what, data[i], (i < lens[m]) ? 0x10 + i : 0xee);
+		}
+	}
+
+	hal_sim_reset();																		// data smaller than the block
+	uint16_t magic = 0x1238;
+	set_eeprom(0, 2, &magic);
+	set_eeprom(2, sizeof(block), block);
+	journal j(J_START, J_START + J_SLOTS * JOURNAL_SLOT);
+	memset(data, 0xee, sizeof(data));
+	check("adopt() into 4 bytes", j.adopt(0, old_blocks, 3, data, 4), 10);
+	check("adopt() into 4 bytes, byte 4", data[4], 0xee);
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- twi queue ----------------------------------------------------------------------------------------------------------
+* with the bus held the transfers pile up in the queue, maintain_twi() is called then like the isr after every byte.
+* the bus has to see the address, the data, a restart between two transfers and the stop at the end, nothing lost,
+* nothing doubled. some rounds of it run the ring over its end a few times.
+*/
+static uint16_t twi_drain(uint8_t *out, uint16_t size, uint8_t *restarts, uint8_t nack = 0xff) {
+	uint16_t cnt = 0;
+	uint8_t data, ack = 1, next;
+	*restarts = 0;
+	for (uint16_t guard = 0; guard < 1000; guard++) {
+		next = maintain_twi(ack, &data);
+		ack = 1;
+		if (next == TWI_STOP) break;
+		if (next == TWI_RESTART) {
+			(*restarts)++;
+			continue;
+		}
+		if (cnt == nack) ack = 0;															// slave doesn't take this byte
+		if (cnt < size) out[cnt] = data;
+		cnt++;
+	}
+	return cnt;
+}
+
+static void check_twi() {
+	uint8_t bus[300], want[300], restarts;
+	uint16_t cnt;
+	char what[48];
+
+	hal_sim_reset();
+	hal_sim_twi_hold(1);
+	check("twi_free() of an empty queue", twi_free(), TWI_QUEUE - 1);
+
+	for (uint8_t round = 0; round < 20; round++) {											// three transfers, one without data
+		uint8_t len = 40 + round * 3, w = 0;
+		twi_begin(0x3c);
+		want[w++] = 0x3c << 1;
+		for (uint8_t i = 0; i < len; i++) {
+			twi_write(round + i);
+			want[w++] = round + i;
+		}
+		twi_end();
+		twi_begin(0x3d);
+		want[w++] = 0x3d << 1;
+		twi_end();
+		twi_begin(0x3c);
+		want[w++] = 0x3c << 1;
+		for (uint8_t i = 0; i < 5; i++) {
+			twi_write(0xa0 + i);
+			want[w++] = 0xa0 + i;
+		}
+		snprintf(what, sizeof(what), "twi_free() in round %u", round);
+		check(what, twi_free(), TWI_QUEUE - 1 - (len + 2) - 2 - (5 + 2));					// the open transfer counts as well
+		twi_end();
+
+		cnt = twi_drain(bus, sizeof(bus), &restarts);
+		snprintf(what, sizeof(what), "twi bytes in round %u", round);
+		check(what, cnt, w);
+		check(what, memcmp(bus, want, w), 0);
+		snprintf(what, sizeof(what), "twi restarts in round %u", round);
+		check(what, restarts, 2);
+		snprintf(what, sizeof(what), "twi_free() after round %u", round);
+		check(what, twi_free(), TWI_QUEUE - 1);
+	}
+
+	/* no ack, the rest of the transfer is dropped, the next one goes out */
+	twi_begin(0x3c);
+	for (uint8_t i = 0; i < 5; i++) twi_write(i);
+	twi_end();
+	twi_begin(0x3d);
+	twi_write(0x99);
+	twi_end();
+	cnt = twi_drain(bus, sizeof(bus), &restarts, 0);
+	check("twi bytes after a nack", cnt, 3);
+	check("twi address after a nack", bus[1], 0x3d << 1);
+	check("twi data after a nack", bus[2], 0x99);
+	check("twi_free() after a nack", twi_free(), TWI_QUEUE - 1);
+
+	/* free bus, every transfer goes out at once, addresses included in the count */
+	hal_sim_twi_hold(0);
+	for (uint8_t n = 0; n < 50; n++) {
+		twi_begin(0x3c);
+		for (uint8_t i = 0; i < 7; i++) twi_write(i);
+		twi_end();
+	}
+	check("hal_sim_twi_bytes() of 50 transfers", hal_sim_twi_bytes(), 50 * 8);
+	check("twi_free() of a free bus", twi_free(), TWI_QUEUE - 1);
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+int main() {
+	check_dshot();
+	check_tasks();
+	check_timers();
+	check_pcint_lockout();
+	check_pcint_events();
+	check_pcint_dispatch();
+	check_journal();
+	check_adopt();
+	check_twi();
+
+	printf("%u checks, %u failed\n", checks, failed);
+	return (failed) ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - host side blaster physics simulator -----------------------------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+#include "sim_blaster.h"
+#include <math.h>
+
+
+BlasterSim::BlasterSim(const s_sim_params &p) : par(p) {
+}
+
+BlasterSim::~BlasterSim() {
+	delete pusher;
+	delete launcher;
+}
+
+void BlasterSim::boot() {
+	delete pusher;
+	delete launcher;
+
+	hal_sim_reset();																		// idle ports, clock at 0
+	fly_rpm = 0;
+	fly_turn = 0;
+	push_rps = 0;
+	push_ang = par.back_pos;																// disc rests on the back sensor
+	volt = par.bat_volt;
+	bat_mv = 0;
+	bat_load_mv = 0;
+	bat_next = 50000;
+	esc_cut_end = 0;
+	loop_next = 0;
+	loop_pass = 0;
+	trig = 0;
+	hal_sim_set_input(sim_pin_frnt, !in_sensor(par.frnt_pos));								// sensor levels before the pusher reads them
+	hal_sim_set_input(sim_pin_back, !in_sensor(par.back_pos));
+
+	init_adc(sim_pin_bat);
+	launcher = new SimLauncher(1000, 2000, (uint16_t)par.fly_rpm_max);
+	pusher = new SimPusher(launcher->ready);
+
+	pusher->mode = &mode;																	// same as the setup() of the sketch
+	pusher->rate = &rate;
+	pusher->recover = &recover;
+	pusher->recovered = &launcher->recovered;
+	pusher->set_dart_callback(launcher->dart_cb, launcher);
+	launcher->fire_speed = &fire_speed;
+	launcher->speedup_time = &speedup_time;
+	launcher->standby_speed = &standby_speed;
+	launcher->standby_time = &standby_time;
+	launcher->ramp = &ramp;
+	launcher->volt = (compensate) ? &bat_load_mv : 0;
+	launcher->learn(16);
+	launcher->init();
+
+	run_us(100000);																			// let the pusher settle
+}
+
+void BlasterSim::trigger(uint8_t pressed) {
+	if (pressed == trig) return;
+	trig = pressed;
+
+	if (pressed) {
+		pusher->start();
+		launcher->start();
+	} else {
+		pusher->stop();
+		launcher->stop();
+	}
+}
+
+void BlasterSim::prerev() {
+	launcher->prerev();
+}
+
+void BlasterSim::run_us(uint32_t us) {
+	float dt = par.step_us / 1000000.0f;
+	for (uint32_t t = 0; t < us; t += par.step_us) {
+		hal_sim_set_adc(sim_pin_bat, (uint16_t)(volt * 1000 / 13.85f));						// battery divider, sampled by the hal every ms
+		hal_sim_advance_us(par.step_us);
+		step(dt);
+		if (hal_sim_micros() < loop_next) continue;											// main loop still busy with the last pass
+
+		if (hal_sim_micros() >= bat_next) {													// battery task of the sketch
+			bat_mv = (uint32_t)get_adc(0) * sim_bat_scale >> 10;
+			bat_load_mv = (uint32_t)get_adc(1) * sim_bat_scale >> 10;
+			if (!bat_load_mv) bat_load_mv = bat_mv;
+			bat_next = hal_sim_micros() + 250000;
+		}
+		timers.poll();																		// the main loop
+		adc_load = launcher->running() | pusher->running();									// same as the launcher task
+		launcher->service();
+		s_pcint_event ev;
+		while (get_PCINT_event(&ev)) pusher->event(ev);
+		pusher->poll();
+		if (!adc_load) launcher->save();													// same as the settings task
+
+		uint8_t slice = par.slice_every && !(++loop_pass % par.slice_every);
+		loop_next = hal_sim_micros() + par.loop_us + ((slice) ? par.slice_us : 0);
+	}
+}
+
+s_sim_result BlasterSim::shot(uint32_t hold_ms, uint32_t timeout_ms) {
+	memset(&res, 0, sizeof(res));
+	res.min_dart_rpm = 100;
+	res.min_volt = volt;
+	first_dart = last_dart = 0;
+	back_center = push_ang;
+	excursion = 0;
+	stopping = 0;
+
+	trig_time = hal_sim_micros();
+	trigger(1);
+	run_us(hold_ms * 1000);
+	trigger(0);
+	stopping = 1;
+
+	uint32_t rest_ms = 0;
+	for (uint32_t ms = 0; ms < timeout_ms; ms++) {
+		run_us(1000);
+
+		/* pusher rests if the motor is released, the disc doesn't move and sits on the back sensor */
+		uint8_t released = !hal_sim_get_output(sim_pin_in1) && !hal_sim_get_output(sim_pin_in2);
+		if (released && (fabsf(push_rps) < 0.05f) && in_sensor(par.back_pos)) rest_ms++;
+		else rest_ms = 0;
+		if (rest_ms >= 20) break;
+	}
+	res.cycle_us = (uint32_t)(hal_sim_micros() - trig_time) - rest_ms * 1000;
+
+	res.overrun_deg = (float)excursion;
+	if (res.darts > 1) res.darts_per_s = (res.darts - 1) * 1000000.0f / (float)(last_dart - first_dart);
+	if (!res.darts) res.min_dart_rpm = 0;
+	return res;
+}
+
+
+/* physics of one integration step, reads the firmware outputs and writes the sensor inputs */
+void BlasterSim::step(float dt) {
+
+	/* flywheel, the esc follows the pulse width with a first order response, speed depends on the battery voltage */
+	float thr = (hal_sim_servo_us(sim_pin_esc) - 1000) / 1000.0f;
+	if (thr < 0) thr = 0;
+	if (thr > 1) thr = 1;
+	if (hal_sim_micros() < esc_cut_end) thr *= par.esc_cut_share;							// low voltage protection cut the power
+	float fly_target = thr * par.fly_rpm_max * volt / par.bat_nominal;
+	float fly_tau = (fly_target > fly_rpm) ? par.fly_tau_up : par.fly_tau_down;
+	float fly_delta = (fly_target - fly_rpm) * dt / fly_tau;
+	if ((par.esc_amp_limit) && (fly_delta > 0)) {											// current limit, no more acceleration than it allows
+		float delta_max = (par.esc_amp_limit - par.fly_amp_idle) / par.fly_amp_per_rpm_s * dt;
+		if (fly_delta > delta_max) fly_delta = delta_max;
+	}
+	fly_rpm += fly_delta;
+
+	/* tach, low active for the first half of every pulse */
+	fly_turn += fly_rpm / 60.0f * TACH_PPR * dt;
+	if (fly_turn >= 1) fly_turn -= floorf(fly_turn);
+	hal_sim_set_input(sim_pin_tach, (fly_turn < 0.5f) ? 0 : 1);							// raises the pin change only on a new level
+
+	float amp = (thr > 0) ? par.fly_amp_idle : 0;
+	if (fly_delta > 0) amp += fly_delta / dt * par.fly_amp_per_rpm_s;
+
+	/* pusher motor behind the tb6612, in1/in2 high/low drives, both high brakes, both low or standby releases */
+	uint8_t in1 = hal_sim_get_output(sim_pin_in1);
+	uint8_t in2 = hal_sim_get_output(sim_pin_in2);
+	uint8_t stby = hal_sim_get_output(sim_pin_stby);
+	float pwm = hal_sim_get_pwm(sim_pin_pwm) / 255.0f;
+
+	float push_target = 0;
+	float push_tau = par.push_tau_coast;
+	if (stby && (in1 != in2)) {
+		push_target = pwm * par.push_rps_max * volt / par.bat_nominal;
+		if (in2) push_target = -push_target;
+		push_tau = par.push_tau;
+		amp += pwm * par.push_amp_max;
+	} else if (stby && in1 && in2) {
+		push_tau = par.push_tau_brake;
+	}
+	push_rps += (push_target - push_rps) * dt / push_tau;
+
+	/* battery sag from the current of this step */
+	volt = par.bat_volt - par.bat_res * amp;
+	if (volt < res.min_volt) res.min_volt = volt;
+	if ((volt < par.esc_volt_cut) && (hal_sim_micros() >= esc_cut_end)) esc_cut_end = hal_sim_micros() + (uint64_t)(par.esc_cut_s * 1e6f);
+
+	/* move the disc and check the sensors */
+	uint8_t frnt_old = in_sensor(par.frnt_pos);
+	uint8_t back_old = in_sensor(par.back_pos);
+	push_ang += push_rps * 360.0f * dt;
+	uint8_t frnt = in_sensor(par.frnt_pos);
+	uint8_t back = in_sensor(par.back_pos);
+
+	if (frnt && !frnt_old && (push_rps > 0)) {												// dart is pushed into the flywheels
+		uint64_t now = hal_sim_micros();
+		if (!res.darts) {
+			res.latency_us = (uint32_t)(now - trig_time);
+			first_dart = now;
+		}
+		last_dart = now;
+		res.darts++;
+
+		float fire_rpm = fire_speed / 100.0f * par.fly_rpm_max;								// fire_speed is % of max_rpm at the nominal voltage
+		float pct = (fire_rpm > 0) ? fly_rpm * 100 / fire_rpm : 0;
+		if (pct < res.min_dart_rpm) res.min_dart_rpm = pct;
+		fly_rpm *= 1 - par.fly_dart_drop;													// the dart takes some energy out of the flywheels
+	}
+
+	if (back && !back_old && (push_rps > 0)) {												// reached the back sensor forward, new reference for the overrun
+		back_center = push_ang + par.sens_width / 2;
+		excursion = 0;
+	}
+	if (stopping && (push_ang - back_center > excursion)) excursion = push_ang - back_center;
+
+	if (frnt != frnt_old) hal_sim_set_input(sim_pin_frnt, !frnt);							// sensors are low active
+	if (back != back_old) hal_sim_set_input(sim_pin_back, !back);
+}
+
+/* 1 if the sensor at pos sees the disc */
+uint8_t BlasterSim::in_sensor(float pos) {
+	double a = fmod(push_ang - pos + par.sens_width / 2, 360.0);
+	if (a < 0) a += 360;
+	return (a < par.sens_width) ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - host side blaster physics simulator -----------------------------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+#ifndef _SIM_BLASTER_h
+#define _SIM_BLASTER_h
+
+/*-- blaster simulator ----------------------------------------------------------------------------------------------------
+* drives the real PusherClass and LauncherClass on top of the linux HAL. the simulator reads the esc pulse width and the
+* tb6612 inputs from the simulated ports, integrates a flywheel and a pusher motor model with a fixed time step and writes
+* the front and back sensor levels back, which raises the pin change interrupts like on the blaster.
+* everything is deterministic, the same parameters give the same result on every run.
+*/
+
+#include "../motors.h"
+
+
+/* pin setup of the FDL-2, same as in the main sketch */
+#define sim_pin_esc    pinB2
+#define sim_pin_in1    pinB5
+#define sim_pin_in2    pinB4
+#define sim_pin_pwm    pinB3
+#define sim_pin_stby   pinB1
+#define sim_pin_frnt   pinD7
+#define sim_pin_back   pinD6
+#define sim_pin_bat    pinC3										// battery divider, 13.85 mV per adc step
+#define sim_bat_scale  886											// same as BAT_SCALE in the main sketch
+#if defined(SIM_NO_TACH)
+#define sim_pin_tach   NO_PIN										// launcher models the flywheel speed
+#else
+#define sim_pin_tach   pinD4										// hall sensor on the flywheel, TACH_PPR pulses per turn
+#endif
+
+typedef LauncherClass<sim_pin_esc, sim_pin_tach> SimLauncher;
+typedef PusherClass<sim_pin_in1, sim_pin_in2, sim_pin_pwm, sim_pin_stby, sim_pin_frnt, sim_pin_back> SimPusher;
+
+
+struct s_sim_params {
+	uint32_t step_us = 20;						// integration step, isr and physics resolution
+
+	/* main loop, the poll functions run once per pass. a pass costs loop_us, every slice_every pass a background task
+	** like the display update takes slice_us on top. 0 for slice_every runs the loop without background slices */
+	uint32_t loop_us = 300;						// fire, timer and launcher task of one pass
+	uint32_t slice_us = 4000;					// one background slice
+	uint8_t  slice_every = 4;					// passes per background slice
+
+	/* flywheel, first order response to the esc command, throttle is (us - 1000) / 1000 */
+	float fly_rpm_max = 30000;					// free running speed at full throttle and nominal voltage
+	float fly_tau_up = 0.120f;					// time constant while accelerating in s
+	float fly_tau_down = 0.400f;				// time constant while the esc is coasting down in s
+	float fly_dart_drop = 0.08f;				// relative speed loss per dart
+	float fly_amp_per_rpm_s = 0.0002f;			// current to accelerate the flywheels, A per rpm/s
+	float fly_amp_idle = 1.5f;					// current at constant speed
+
+	/* esc protection, both off with 0. the current limit holds the flywheel current at esc_amp_limit by cutting the
+	** acceleration, the low voltage protection cuts the power to esc_cut_share for esc_cut_s once the battery is below
+	** esc_volt_cut, the power comes back as long as the voltage stays above it */
+	float esc_amp_limit = 0;					// current limit in A
+	float esc_volt_cut = 0;						// low voltage protection in V
+	float esc_cut_share = 0.5f;					// share of the throttle while the power is cut
+	float esc_cut_s = 0.050f;					// time the power stays cut in s
+
+	/* pusher motor, one turn of the disc is one dart */
+	float push_rps_max = 12.0f;					// turns per second at pwm 255 and nominal voltage
+	float push_tau = 0.015f;					// time constant while driven in s
+	float push_tau_brake = 0.006f;				// time constant while braking (in1 and in2 high) in s
+	float push_tau_coast = 0.060f;				// time constant while released in s
+	float push_amp_max = 2.5f;					// current at pwm 255
+
+	/* sensor geometry in degree of the pusher disc, sensors are low active */
+	float back_pos = 0;							// back sensor, resting position of the pusher
+	float frnt_pos = 180;						// front sensor, dart is pushed into the flywheels
+	float sens_width = 20;						// angle a sensor is active
+
+	/* battery, 3s lipo */
+	float bat_volt = 12.4f;						// open circuit voltage
+	float bat_res = 0.060f;						// internal resistance in ohm
+	float bat_nominal = 12.0f;					// voltage the motor speeds above are referenced to
+};
+
+struct s_sim_result {
+	uint8_t  darts;								// darts pushed after the trigger press
+	uint32_t latency_us;						// trigger press to the first dart, 0 if no dart
+	float    darts_per_s;						// rate between first and last dart, 0 for a single dart
+	uint32_t cycle_us;							// trigger press till the pusher rests at the back sensor
+	float    overrun_deg;						// how far the disc went past the back sensor while stopping
+	float    min_dart_rpm;						// lowest flywheel speed a dart was pushed into, in % of the fire speed
+	float    min_volt;							// lowest battery voltage
+};
+
+
+class BlasterSim {
+public:
+	s_sim_params par;
+
+	/* the sketch settings the firmware works with */
+	uint8_t  mode = 2;
+	uint8_t  fire_speed = 80;
+	uint16_t speedup_time = 500;
+	uint8_t  standby_speed = 50;
+	uint16_t standby_time = 500;
+	uint8_t  rate = 0;
+	uint8_t  recover = 0;
+	uint8_t  ramp = 0;
+	uint8_t  compensate = 1;					// hand the measured battery voltage to the launcher
+
+	BlasterSim(const s_sim_params &p);
+	~BlasterSim();
+
+	void boot();								// reset the hal, build pusher and launcher and let the pusher find its home position
+	void trigger(uint8_t pressed);				// same as the fire button handling in the main loop
+	void prerev();								// same as a pre-rev hint of the sketch
+	SimLauncher *get_launcher() { return launcher; }
+	void run_us(uint32_t us);					// advance the simulation
+
+	/* press, hold for hold_ms, release and wait till the pusher rests or timeout_ms is over */
+	s_sim_result shot(uint32_t hold_ms, uint32_t timeout_ms = 3000);
+
+	float flywheel_rpm() { return fly_rpm; }
+	float pusher_angle() { return push_ang; }
+	float battery_volt() { return volt; }
+
+private:
+	SimLauncher *launcher = 0;
+	SimPusher *pusher = 0;
+
+	float fly_rpm = 0;
+	float fly_turn = 0;							// fraction of the current flywheel turn, for the tach pulses
+	float push_rps = 0;							// signed, positive is forward
+	double push_ang = 0;						// unwrapped angle in degree
+	float volt = 0;
+	uint16_t bat_mv = 0;						// battery voltage at rest as the sketch measures it, every 250 ms
+	uint16_t bat_load_mv = 0;					// and under load, handed to the launcher
+	uint64_t esc_cut_end = 0;					// low voltage protection of the esc cuts the power till then
+	uint64_t bat_next = 0;
+
+	uint64_t loop_next = 0;						// the main loop is busy with the last pass till then
+	uint8_t loop_pass = 0;
+
+	uint8_t trig = 0;
+	uint64_t trig_time;
+
+	/* measurement of the current shot */
+	s_sim_result res;
+	uint64_t first_dart, last_dart;
+	double back_center;							// unwrapped angle of the back sensor center, last time it was reached forward
+	double excursion;							// largest angle past back_center since then
+	uint8_t stopping;
+
+	void step(float dt);
+	uint8_t in_sensor(float pos);
+};
+
+#endif
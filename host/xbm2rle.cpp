@@ -0,0 +1,141 @@
+/*- -----------------------------------------------------------------------------------------------------------------------
+*  FDL-2 arduino implementation
+*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
+* - -----------------------------------------------------------------------------------------------------------------------
+* - bitmap converter, xbm to the rle format of rle_expand() ---------------------------------------------------------------
+*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
+* - -----------------------------------------------------------------------------------------------------------------------
+*/
+
+/*-- converter ------------------------------------------------------------------------------------------------------------
+* reads an xbm file, as gimp exports it, and writes a header with the bitmap in the tile order of the display, rle
+* compressed, see bitmap functions in myfunc.h. every tile row is packed on its own, so a page can be expanded without
+* the rows before. the result is expanded again with rle_expand() and compared, so a broken stream never gets into
+* the sketch. build and run from the sketch folder:
+*
+*   g++ -std=gnu++11 -O2 -I. myfunc.cpp HAL_linux.cpp host/xbm2rle.cpp -o xbm2rle
+*   ./xbm2rle host/mylogo.xbm logo > mylogo.h
+*/
+
+#include "../myfunc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define MAX_W 256
+#define MAX_H 64
+
+static uint8_t xbm[MAX_W / 8 * MAX_H];
+static uint8_t tile[MAX_W * MAX_H / 8];
+static uint8_t rle[MAX_W * MAX_H / 8 * 2];
+
+/* width, height and the bits of an xbm file, 0 if it is not readable */
+static uint8_t read_xbm(const char *path, uint16_t *w, uint16_t *h) {
+	FILE *f = fopen(path, "r");
+	if (!f) return 0;
+
+	char line[256];
+	uint16_t len = 0;
+	uint8_t data = 0;
+	*w = *h = 0;
+	while (fgets(line, sizeof(line), f)) {
+		char *p;
+		if ((p = strstr(line, "_width "))) *w = atoi(p + 7);
+		else if ((p = strstr(line, "_height "))) *h = atoi(p + 8);
+		else if (strchr(line, '{')) data = 1;
+
+		for (p = line; data && (p = strstr(p, "0x")); p += 2) {
+			if (len >= sizeof(xbm)) break;
+			xbm[len++] = (uint8_t)strtol(p, 0, 16);
+		}
+	}
+	fclose(f);
+
+	if ((!*w) || (*w > MAX_W) || (!*h) || (*h > MAX_H) || (*h % 8)) return 0;					// whole tile rows only
+	return (len == (*w + 7) / 8 * *h) ? 1 : 0;
+}
+
+/* xbm is line by line, lsb is the left pixel. a tile byte is a column of 8 pixels, lsb on top */
+static void to_tiles(uint16_t w, uint16_t h) {
+	for (uint16_t row = 0; row < h / 8; row++) {
+		for (uint16_t x = 0; x < w; x++) {
+			uint8_t b = 0;
+			for (uint8_t y = 0; y < 8; y++) {
+				if (xbm[(row * 8 + y) * ((w + 7) / 8) + x / 8] & (1 << (x % 8))) b |= 1 << y;
+			}
+			tile[row * w + x] = b;
+		}
+	}
+}
+
+/* one block, runs of 3 and more equal bytes are repeated, everything else goes as literals, 128 bytes at most per run */
+static uint16_t pack(const uint8_t *src, uint16_t len, uint8_t *dst) {
+	uint16_t out = 0, i = 0;
+	while (i < len) {
+		uint16_t run = 1;
+		while ((i + run < len) && (src[i + run] == src[i]) && (run < 128)) run++;
+		if (run >= 3) {
+			dst[out++] = 0x80 + run - 1;
+			dst[out++] = src[i];
+			i += run;
+			continue;
+		}
+
+		uint16_t lit = 0;																	// literals till the next run of 3
+		while ((i + lit < len) && (lit < 128)) {
+			if ((i + lit + 2 < len) && (src[i + lit] == src[i + lit + 1]) && (src[i + lit] == src[i + lit + 2])) break;
+			lit++;
+		}
+		dst[out++] = lit - 1;
+		memcpy(&dst[out], &src[i], lit);
+		out += lit;
+		i += lit;
+	}
+	return out;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s bitmap.xbm name > header.h\n", argv[0]);
+		return 1;
+	}
+
+	uint16_t w, h;
+	if (!read_xbm(argv[1], &w, &h)) {
+		fprintf(stderr, "can't read %s, or the height is not a multiple of 8\n", argv[1]);
+		return 1;
+	}
+	to_tiles(w, h);
+
+	uint16_t len = 0;
+	for (uint16_t row = 0; row < h / 8; row++) len += pack(&tile[row * w], w, &rle[len]);
+
+	static uint8_t check[sizeof(tile)];														// expand it again, same as the sketch does
+	const uint8_t *src = rle;
+	for (uint16_t row = 0; row < h / 8; row++) src = rle_expand(src, &check[row * w], w);
+	if ((src != rle + len) || memcmp(check, tile, w * h / 8)) {
+		fprintf(stderr, "rle check failed\n");
+		return 1;
+	}
+
+	const char *name = argv[2];
+	printf("/*- -----------------------------------------------------------------------------------------------------------------------\n");
+	printf("*  FDL-2 arduino implementation\n");
+	printf("*  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/\n");
+	printf("* - -----------------------------------------------------------------------------------------------------------------------\n");
+	printf("* - bitmaps for the 0.9inch oled display, made by host/xbm2rle.cpp, don't edit --------------------------------------------\n");
+	printf("*   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen\n");
+	printf("* - -----------------------------------------------------------------------------------------------------------------------\n");
+	printf("*/\n\n");
+	printf("#ifndef _MYLOGO_h\n#define _MYLOGO_h\n\n");
+	printf("/* %s, %u x %u pixel, %u bytes instead of %u, expand every tile row with rle_expand() */\n", argv[1], w, h, len, w * h / 8);
+	printf("#define %s_width  %u\n", name, w);
+	printf("#define %s_rows   %u\n\n", name, h / 8);
+	printf("static const uint8_t %s_rle[] PROGMEM = {", name);
+	for (uint16_t i = 0; i < len; i++) printf("%s0x%02x%s", (i % 24) ? " " : "\n\t", rle[i], (i < len - 1) ? "," : " };\n");
+	printf("\n#endif\n");
+
+	fprintf(stderr, "%s: %u x %u, %u bytes rle, %u raw\n", argv[1], w, h, len, w * h / 8);
+	return 0;
+}
@@ -10,89 +10,1198 @@
 #ifndef _MOTORS_h
 #define _MOTORS_h
 
-#include <Servo.h>
 #include "myfunc.h"
+#if defined(__AVR__)
+#include <Servo.h>
+#endif
 
 //#define DEBUG_PUSHER
 //#define DEBUG_LAUNCHER
+//#define LAUNCHER_DSHOT 300		// dshot150 or dshot300 to the esc instead of the servo pulse, the esc has to support it
+
+#define TACH_PPR       1			// tach pulses per flywheel turn
+#define TACH_TOLERANCE 10			// launcher is ready at this % below the target rpm
+#define TACH_LOCK      100			// lockout of the tach input in us, far below the pulse time at full speed
+
+#define DROOP_DART     80			// flywheel speed lost per dart in 0.1 %, model without tach
+#define DROOP_HALF     80			// ms the esc needs to halve a speed deficit, model without tach
+
+#define RAMP_STEPS     16			// entries of a spin-up profile
+#define RAMP_STEP      4			// ms per entry, the whole ramp takes 64 ms
+#define RAMP_LEAD      128			// head start of the current limited profile in 1/256 of the way
+#define RAMP_PROFILES  3			// 1 linear, 2 s-curve, 3 current limited, 0 writes the target at once
+
+#define THROTTLE_POINTS 5			// throttle curve, pulse width over min_speed at 0, 25, 50, 75 and 100 % of max_rpm
+#define THROTTLE_SIZE  (THROTTLE_POINTS * 2)	// bytes in the eeprom, behind the spin-up table
+#define THROTTLE_SETTLE 300			// ms at fire speed without a dart, before the tach corrects the curve
+#define VOLT_REF       12000		// mV, max_rpm and the throttle curve are taken at this battery voltage
+
+#define STANDBY_MIN    200			// ms, shortest adapted standby time
+#define STANDBY_MAX    5000			// ms, longest adapted standby time
+
+#define SPINUP_SPEEDS  4			// learned spin-up times, fire_speed 50 - 100 % in 4 steps,
+#define SPINUP_STATES  3			// launcher stopped, standby or stopping,
+#define SPINUP_LEVELS  3			// and battery level in 3 steps
+#define SPINUP_SIZE    (SPINUP_SPEEDS * SPINUP_STATES * SPINUP_LEVELS)	// bytes in the eeprom
+#define SPINUP_UNIT    4			// ms per step of a table entry, 0 and 0xff are unknown
+#define LEARN_SIZE     (SPINUP_SIZE + THROTTLE_SIZE)	// eeprom block of learn(), table and curve
+
+#define SENSOR_LOCK 1000			// lockout of the pusher sensors in us, a sensor is passed in less than 5 ms at full speed
+#define BRAKE_LEAD  14000			// start value in us for the time the pusher disc needs to stop once braked
+#define BRAKE_MIN   20000			// shortest brake time in us, the brake is held 4 times the lead
+#define PUSHER_DPS  12				// darts per second at full pwm, start value of the rate controller
+#define PUSHER_PWM_MIN 60			// lowest pwm of the rate controller, the disc stalls below
+
+#ifdef DEBUG_PUSHER
+#define dbg_p Serial
+#else
+#define dbg_p Noserial
+#endif
+
+#ifdef DEBUG_LAUNCHER
+#define dbg_l Serial
+#else
+#define dbg_l Noserial
+#endif
 
 
 
 /**
-* @brief contructor for the pusher class to drive the pusher motor of a FDL-2
+* @brief pusher class to drive the pusher motor of a FDL-2, the pins are template parameters, so port and bit of every
+*        pin are resolved at compile time and a pin write in the braking path is a single sbi/cbi
 *
-* @parameter (uint8_t) IN1 pin, (uint8_t) IN2 pin, (uint8_t) PWM pin, (uint8_t) STBY pin, (uint8_t) FRNT_SENS pin, (uint8_t) BACK_SENS pin
+* @template (uint8_t) IN1 pin, (uint8_t) IN2 pin, (uint8_t) PWM pin, (uint8_t) STBY pin, (uint8_t) FRNT sensor pin, (uint8_t) BACK sensor pin
+* @parameter (uint8_t) launcher_enable
 */
+template <uint8_t IN1, uint8_t IN2, uint8_t PWM, uint8_t STBY, uint8_t FRNT, uint8_t BACK>
 class PusherClass {
 public:
 	uint8_t *mode;					// how many darts to be launched by one start
-	PusherClass(uint8_t IN1, uint8_t IN2, uint8_t PWM, uint8_t STBY, uint8_t FRNT_SENS, uint8_t BACK_SENS, uint8_t &launcher_enable);
+	uint8_t *rate;					// darts per second, 0 is full speed
+	uint8_t *recover;				// ms the pusher holds on the back sensor at most till the flywheels recovered, 0 is off
+	volatile uint8_t *recovered;	// optional flywheel state from the launcher, without it the pusher holds recover ms
+	PusherClass(volatile uint8_t &launcher_enable);
 
 	void set_speed(uint8_t speed);	// set speed and remembers it
 	void start();					// start the pusher 
 	void stop();					// init the stop process
+	uint8_t running();				// 1 while the motor is driven or braked
+	uint8_t latency(uint32_t *us);	// 1 once per shot, us from start() till step() drove the motor
 
-	void poll();					// poll function to operate the pusher
+	void poll();					// poll function to operate the pusher, start() and stop() may come from an isr meanwhile
 
-	void callback(uint8_t vec, uint8_t pin, uint8_t flag);
+	void callback(uint8_t pin_def, uint8_t level, uint32_t time);	// ISR-SAFE, sensor handling which can't wait
+	void event(const s_pcint_event &ev);	// sensor handling in the main loop, feed with the queued pin change events
+	void set_dart_callback(void(*callback)(void *arg, uint32_t time), void *arg = 0);	// called from the sensor isr on every dart
 
 private:
-	uint8_t *enable;				// pointer to an enable variable - 1 means enabled (pusher shall start only while the launcher is at full speed)
+	volatile uint8_t *enable;		// pointer to an enable variable - 1 means enabled (pusher shall start only while the launcher is at full speed)
+
+	volatile uint8_t operate;		// state machine, 0 inactive, 1 starting, 2 running, 3 returning, 4 breaking, 5 stopping, 6 holding
+	volatile uint8_t position;		// 0 unknown, 10 unknown but motor started, 1 front sensor, 2 after frontsensor, 12 after frontsensor but slow speed, 3 back sensor, 4 after back sensor 
+	uint32_t frnt_time, back_time;	// time the sensors were reached, main loop only
+	uint32_t back_left, frnt_in, frnt_out;	// time the back sensor was left and the front sensor reached and left, isr only
+	uint16_t cruise;				// back sensor left to front sensor reached in us, same angle as front left to back reached
+	volatile uint16_t brake_lead;	// learned time in us the disc needs to stop once braked
+	volatile uint8_t brake_plan;	// 1 brake point predicted and alarm set, 2 braked on it
+	volatile uint8_t round;			// pushed darts counter
+	uint8_t run_pwm;				// pwm while running, output of the rate controller
+	uint8_t rate_for;				// rate run_pwm belongs to, 0 if nothing measured yet
+	volatile uint8_t held;			// 1 if the pusher was held since the last dart, the interval is no rate measurement
+	uint32_t start_at;				// time of the last start(), mostly set in the trigger isr
+	uint32_t motor_lat;				// start() to motor on in us, main loop only
+	uint8_t motor_new;				// 1 till latency() reported motor_lat
 
-	uint8_t pin_in1;				// remember the pin definition/numbers
-	uint8_t pin_in2;
-	uint8_t pin_stb;
-	uint8_t pin_pwm;
+	waittimer timer;				// mainly used for breaking the motor as non block delay in the poll function
+	void(*dart_cb)(void *arg, uint32_t time);
+	void *dart_arg;
+	uint8_t idle();					// 1 if step() would leave at once, reads single bytes only
+	void step();					// one step of the state machine, called by poll() with interrupts off
+	uint8_t brake_predict(uint32_t now);	// arms the alarm for the brake point after the front sensor, 0 if the speed is unknown
+	void brake();					// ISR-SAFE, brakes on the predicted point
+	void brake_learn(int8_t late);	// 1 stopped behind the back sensor, -1 before it
+	uint8_t rate_pwm();				// pwm to start with for the current rate
+	void rate_adjust(uint32_t period);	// closes the loop on the measured dart interval
+	static void sensor_cb(void *obj, uint8_t pin_def, uint8_t level, uint32_t time);
+	static void brake_cb(void *obj);
+};
+#define PUSHER_T template <uint8_t IN1, uint8_t IN2, uint8_t PWM, uint8_t STBY, uint8_t FRNT, uint8_t BACK>
+#define PUSHER   PusherClass<IN1, IN2, PWM, STBY, FRNT, BACK>
 
-	uint8_t pin_frnt;				// remember the front and back sensor pins
-	uint8_t pin_back;
 
-	uint8_t operate;				// state machine, 0 inactive, 1 starting, 2 running, 3 returning, 4 breaking, 5 stopping
-	uint8_t position;				// 0 unknown, 10 unknown but motor started, 1 front sensor, 2 after frontsensor, 12 after frontsensor but slow speed, 3 back sensor, 4 after back sensor 
-	uint8_t position_old;			// to detect changes of the position
-	uint8_t round;					// pushed darts counter
 
-	waittimer timer;				// mainly used for breaking the motor as non block delay in the poll function
+
+#if defined(LAUNCHER_DSHOT)
+/**
+* @brief dshot output for the launcher esc, same interface as the servo library. a new throttle is sent at once instead
+*        of waiting for the next 20 ms servo period, service() repeats the frame every ms as the esc expects a steady stream.
+*        stop frames are repeated every DSHOT_IDLE ms only, enough to keep the esc armed.
+*        on the atmega the frame is bit banged with interrupts off by a loop counted in cycles, 16 * DSHOT_BIT cycles,
+*        53 us at dshot300 and 106 us at dshot150. the pin change isrs and the brake alarm of the pusher wait up to this
+*        long while the launcher runs, the atmega has no peripheral left on the esc pin to send the frame by itself.
+*
+* @template (uint8_t) ESC pin
+*/
+#define DSHOT_BIT  (F_CPU / (LAUNCHER_DSHOT * 1000UL))	// cycles per bit, 53 at dshot300
+#define DSHOT_T1H  (DSHOT_BIT * 3 / 4)		// high time of a 1
+#define DSHOT_T0H  (DSHOT_BIT * 3 / 8)		// high time of a 0
+#define DSHOT_IDLE 10						// ms between two stop frames
+#define DSHOT_DELAY(k, r) "ldi  %[tmp], %[" #k "]\n9:\n\tdec  %[tmp]\n\tbrne 9b\n\t.rept %[" #r "]\n\tnop\n\t.endr\n\t"	// 3 * k + r cycles
+
+template <uint8_t ESC>
+class DshotClass {
+public:
+	uint8_t attach(int pin, int min, int max);	// pin is given by the template, min and max pulse width map on the throttle range
+	void writeMicroseconds(int value);	// map the pulse width on the dshot throttle and send it at once
+	uint8_t service();				// repeat the last frame every ms, 1 if a frame was sent
+
+private:
+	uint16_t min_us;
+	uint16_t max_us;
+	volatile uint16_t packet;		// last frame, written by start() and stop() which may come from an isr
+	uint32_t last;					// get_micros() of the last frame
+	void send();
 };
 
-static PusherClass *pcint_callback;
-void pcint_hook(uint8_t vec, uint8_t pin, uint8_t flag);
+template <uint8_t ESC>
+uint8_t DshotClass<ESC>::attach(int, int min, int max) {
+	min_us = min;
+	max_us = max;
+	Pin<ESC>::output();
+	Pin<ESC>::low();															// idle level between the frames
+	packet = dshot_packet(0, 0);												// stop, the esc arms on a stream of stop frames
+	return 1;
+}
+
+template <uint8_t ESC>
+void DshotClass<ESC>::writeMicroseconds(int value) {
+	uint16_t throttle = 0;														// everything up to min is stop
+	if (value > (int)min_us) {
+		uint32_t t = DSHOT_MIN + (uint32_t)(value - min_us) * (DSHOT_MAX - DSHOT_MIN) / (max_us - min_us);
+		throttle = (t > DSHOT_MAX) ? DSHOT_MAX : t;
+	}
+	packet = dshot_packet(throttle, 0);
+	send();																		// no need to wait for the next frame
+}
+
+template <uint8_t ESC>
+uint8_t DshotClass<ESC>::service() {
+	uint32_t every = (packet >> 5) ? 1000 : DSHOT_IDLE * 1000UL;				// throttle 0 is the stop frame
+	if (get_micros() - last < every) return 0;
+	send();
+	return 1;
+}
+
+template <uint8_t ESC>
+void DshotClass<ESC>::send() {
+	last = get_micros();
+#if defined(__AVR__)
+	/* sbi, cbi, rjmp and a taken brne take 2 cycles, sbrs skipping the rjmp 2, the rest 1. a delay of n cycles is a
+	** loop of 3 * (n / 3) cycles plus n % 3 nops. a 1 is high for sbi + sbrs + delay, a 0 for sbi + sbrs + rjmp + delay,
+	** the low time ends with the shift and the loop jump of the next bit. */
+	static_assert((DSHOT_T0H - 5 >= 3) && (DSHOT_BIT - DSHOT_T1H - 9 >= 3) && (DSHOT_T1H - 4 < 3 * 256), "dshot delays out of range");
+	uint16_t p = packet;
+	uint8_t cnt, tmp;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {											// bit timing needs the cpu for the whole frame
+		asm volatile (
+			"ldi  %[cnt], 16"				"\n"
+			"1:"							"\n\t"
+			"sbi  %[port], %[bit]"			"\n\t"	// bit starts high, msb first
+			"sbrs %B[p], 7"					"\n\t"
+			"rjmp 2f"						"\n\t"
+			DSHOT_DELAY(h1k, h1r)					// a 1
+			"cbi  %[port], %[bit]"			"\n\t"
+			DSHOT_DELAY(l1k, l1r)
+			"rjmp 3f"						"\n"
+			"2:"							"\n\t"
+			DSHOT_DELAY(h0k, h0r)					// a 0
+			"cbi  %[port], %[bit]"			"\n\t"
+			DSHOT_DELAY(l0k, l0r)
+			"3:"							"\n\t"
+			"lsl  %A[p]"					"\n\t"
+			"rol  %B[p]"					"\n\t"
+			"dec  %[cnt]"					"\n\t"
+			"brne 1b"						"\n"
+			: [p] "+r" (p), [cnt] "=&d" (cnt), [tmp] "=&d" (tmp)
+			: [port] "I" ((ESC < 8) ? _SFR_IO_ADDR(PORTD) : (ESC < 14) ? _SFR_IO_ADDR(PORTB) : _SFR_IO_ADDR(PORTC)),
+			  [bit] "I" ((ESC < 8) ? ESC : (ESC < 14) ? ESC - 8 : ESC - 14),
+			  [h1k] "M" ((DSHOT_T1H - 4) / 3), [h1r] "M" ((DSHOT_T1H - 4) % 3),
+			  [l1k] "M" ((DSHOT_BIT - DSHOT_T1H - 9) / 3), [l1r] "M" ((DSHOT_BIT - DSHOT_T1H - 9) % 3),
+			  [h0k] "M" ((DSHOT_T0H - 5) / 3), [h0r] "M" ((DSHOT_T0H - 5) % 3),
+			  [l0k] "M" ((DSHOT_BIT - DSHOT_T0H - 7) / 3), [l0r] "M" ((DSHOT_BIT - DSHOT_T0H - 7) % 3)
+		);
+	}
+#else
+	hal_sim_dshot(ESC, packet);
+#endif
+}
+#endif
+
+
+
 
+/*-- spin-up profiles ----------------------------------------------------------------------------------------------------
+* share of the way from the start to the target pulse width per ramp step in 1/256, generated by the compiler. the last
+* step is not in the table, it writes the target itself.
+* linear rises evenly, s-curve (smoothstep 3x^2 - 2x^3) starts and ends soft and current limited starts with RAMP_LEAD
+* and rises evenly then. the esc current follows the gap between throttle and flywheel speed, a flywheel accelerating
+* at a constant rate keeps this gap and with it the current constant.
+* the profiles are there to keep the peak current and the battery sag down, not to get to speed sooner. on a fresh pack
+* the plain step is the fastest. only on a worn pack with an esc which cuts the power on low voltage does the current
+* limited profile avoid the cut and beat the step. an esc with its own current limit makes the step as fast again,
+* see the ramp table of host/bench_blaster.cpp.
+*/
+constexpr uint8_t ramp_linear(uint8_t i) { return 256UL * (i + 1) / RAMP_STEPS; }
+constexpr uint8_t ramp_scurve(uint8_t i) { return 256UL * (3UL * (i + 1) * (i + 1) * RAMP_STEPS - 2UL * (i + 1) * (i + 1) * (i + 1)) / (1UL * RAMP_STEPS * RAMP_STEPS * RAMP_STEPS); }
+constexpr uint8_t ramp_current(uint8_t i) { return RAMP_LEAD + (256UL - RAMP_LEAD) * (i + 1) / RAMP_STEPS; }
+
+#define RAMP_ROW(f) { f(0), f(1), f(2), f(3), f(4), f(5), f(6), f(7), f(8), f(9), f(10), f(11), f(12), f(13), f(14), 0 }
+static_assert(RAMP_STEPS == 16, "RAMP_ROW lists 16 entries");
+static const uint8_t ramp_table[RAMP_PROFILES][RAMP_STEPS] PROGMEM = { RAMP_ROW(ramp_linear), RAMP_ROW(ramp_scurve), RAMP_ROW(ramp_current) };
+//- -----------------------------------------------------------------------------------------------------------------------
 
 
 
 /**
-* @brief contructor for the launcher class to accelerate the darts in a FDL-2
+* @brief launcher class to accelerate the darts in a FDL-2. with a tach pin the flywheel speed is measured and the
+*        launcher is ready as soon as it is within TACH_TOLERANCE of the target rpm, speedup_time is the upper limit then.
+*        the target is max_rpm scaled by the throttle.
+*        with learn() the measured spin-up times are kept in a table by fire_speed, launcher state and battery level and
+*        stored in the eeprom. a known table entry replaces speedup_time for the start, the tach keeps it up to date.
+*        without a tach there is nothing to learn the times from, the table is left out and speedup_time is used.
+*        fire_speed and standby_speed are % of max_rpm. the pulse width comes from a throttle curve, taken at VOLT_REF and
+*        scaled by VOLT_REF / volt, so the flywheel speed doesn't depend on the battery. the curve is stored behind the
+*        spin-up table, with a tach it is corrected on every stop from a settled fire speed.
+*        at fire speed recovered reports if the flywheel is within TACH_TOLERANCE after a dart, measured with the tach,
+*        without it modelled from the darts reported to dart().
+*        with ramp set, start() goes to the fire speed along one of the spin-up profiles, one step every RAMP_STEP ms.
+*        prerev() brings a stopped launcher to standby speed when a shot is likely. standby_time is the start value of the
+*        standby time in use, it shrinks on every standby without a shot and grows on a shot shortly after the standby.
+*        a new standby_time starts the adaption over, 0 is no standby.
 *
-* @parameter (uint8_t) ESC pin, (uint16_t) min_speed, (uint16_t) max_speed
+* @template (uint8_t) ESC pin, (uint8_t) TACH pin, NO_PIN without tach
+* @parameter (uint16_t) min_speed, (uint16_t) max_speed, (uint16_t) max_rpm at full throttle
 */
+template <uint8_t ESC, uint8_t TACH = NO_PIN>
 class LauncherClass {
 public:
-	uint8_t ready;					// signals readiness of launcher 
-	uint8_t *fire_speed;			// fire speed in % of max_speed
+	volatile uint8_t ready;			// signals readiness of launcher 
+	uint8_t *fire_speed;			// fire speed in % of max_rpm
 	uint16_t *speedup_time;			// holds the time the motor needs to speedup
-	uint8_t *standby_speed;			// standby speed in % of max_speed
+	uint8_t *standby_speed;			// standby speed in % of max_rpm
 	uint16_t *standby_time;			// standby time in ms
+	uint8_t *battery;				// battery level in %, optional, selects the spin-up table column
+	volatile uint8_t recovered;		// 1 while the flywheel speed is within tolerance, 0 after a dart till it recovered
+	uint8_t *ramp;					// spin-up profile, optional, 0 writes the fire speed at once
+	uint16_t *volt;					// battery voltage in mV, optional, scales the throttle
 
-	LauncherClass(uint8_t ESC, uint16_t min_speed, uint16_t max_speed);
+	LauncherClass(uint16_t min_speed, uint16_t max_speed, uint16_t max_rpm = 0);
 
 	void init();					// init the launcher, write start value into the ESC
 	void start();					// init the start process of the launcher 
 	void stop();					// init the stop process via standby speed 
 
-	void poll();					// poll function to operate the pusher
+	void poll();					// state machine step, called by the timer service when the timer expires
+	uint8_t service();				// keeps the esc output alive, call it every loop pass, 1 if it did some work
+	uint16_t rpm();					// measured flywheel speed, 0 without tach or if the flywheel stands
+	void learn(uint16_t addr);		// load the spin-up table and the throttle curve from the eeprom and keep them up to date there
+	uint8_t save();				// writes one changed byte of the learned data while stopped, 1 if it did some work
+	uint16_t throttle(uint8_t percent);	// pulse width for a speed in % of max_rpm at the current battery voltage
+	void dart(uint32_t time);		// ISR-SAFE, a dart was pushed into the flywheels
+	void prerev();					// ISR-SAFE, a shot is likely, go to standby speed if stopped
+	uint16_t standby();				// standby time in use in ms, 0 if standby_time is 0
+	uint8_t running();				// 1 while the flywheels are driven, standby included
+	static void dart_cb(void *obj, uint32_t time);	// for PusherClass::set_dart_callback()
 
 private:
-	uint8_t mode = 0;				// 0 = stopped, 10 = stopping, 1 = standby (reduced speed), 11 = going to standby speed, 2 = fire speed, 12 / 22 = accelerating to fire speed
-	uint8_t pin_esc;
+	volatile uint8_t mode = 0;		// 0 = stopped, 10 = stopping, 1 = standby (reduced speed), 11 = going to standby speed, 2 = fire speed, 12 / 22 = accelerating to fire speed
+#if defined(LAUNCHER_DSHOT)
+	DshotClass<ESC> myServo;		// dshot output, same interface as the servo
+#else
 	Servo myServo;					// create a servo object
+#endif
 
 	uint16_t min_speed;
 	uint16_t max_speed;
 	uint16_t set_speed;
+	uint16_t out_speed;				// pulse width last written to the esc
+	void write(uint16_t speed);
+
+	uint16_t ramp_from;				// pulse width the ramp started at
+	volatile uint8_t ramp_idx;		// next ramp step, RAMP_STEPS if no ramp is running
+	waittimer ramp_timer;
+	void ramp_next();
+	static void ramp_cb(void *obj);
+
+	uint16_t max_rpm;
+	volatile uint32_t tach_time;	// get_micros() of the last tach pulse
+	volatile uint16_t tach_period;	// time between the last two pulses in us, 0xffff is too slow to measure
+	uint16_t tach_limit;			// longest period which counts as up to speed, set by start()
+	volatile uint8_t tach_ready;	// target reached while accelerating, the timer is cut short once
+
+	uint16_t spin_addr;				// eeprom address of the spin-up table, 0 without learning
+	uint8_t spin[(TACH == NO_PIN) ? 1 : SPINUP_SIZE];	// learned spin-up times in SPINUP_UNIT ms, only with a tach
+	uint8_t spin_idx;				// table entry of the running start, 0xff if none
+	uint8_t spin_dirty;			// table changed, written by save() when the launcher is stopped
+	uint8_t save_pos;			// next byte save() compares with the eeprom, LEARN_SIZE if idle
+	uint32_t spin_start;			// get_micros() of start()
+	volatile uint32_t spin_time;	// start() to target rpm in us, from the tach
+	uint8_t spinup_index();
+	void spinup_learn();
+
+	uint16_t curve[THROTTLE_POINTS];	// pulse width over min_speed at VOLT_REF
+	volatile uint8_t curve_dirty;	// curve changed, written by save() when the launcher is stopped
+	volatile uint32_t fire_time;	// get_millis() of the fire speed reached or the last dart
+	void throttle_learn();
+
+	uint16_t standby_ms;			// standby time in use, adapted from standby_time
+	uint16_t standby_set;			// standby_time standby_ms was taken from, a new setting starts over
+	uint32_t standby_start;			// get_millis() the standby speed was reached, 0 if none since the last start
+
+	uint16_t droop;					// modelled speed deficit in 0.1 % at droop_time
+	uint32_t droop_time;			// get_micros() of the last dart
+	waittimer droop_timer;			// modelled recovery, sets recovered
 
 	waittimer timer;
+	void arm(uint16_t ms);			// set the timer, with 0 ms the next step follows with the next timers.poll()
+	static void timer_cb(void *obj);
+	static void tach_cb(void *obj, uint8_t pin_def, uint8_t level, uint32_t time);
+	static void droop_cb(void *obj);
 };
+#define LAUNCHER_T template <uint8_t ESC, uint8_t TACH>
+#define LAUNCHER   LauncherClass<ESC, TACH>
+
+
+
+/*-- pusher and launcher -------------------------------------------------------------------------------------------------
+* class templates, so the implementation has to be visible where the classes are instanciated
+*/
+PUSHER_T
+PUSHER::PusherClass(volatile uint8_t &launcher_enable) : enable(&launcher_enable) {
+
+	Pin<IN1>::output();															// the tb6612 chip has 2 inputs for driving the motor
+	Pin<IN1>::low();															// we need to set them as output and low at the arduino side
+
+	Pin<IN2>::output();
+	Pin<IN2>::low();
+
+	Pin<PWM>::output();															// pwm drives the speed of the pusher motor
+	set_speed(0);																// we use the standard arduino function for it
+
+	Pin<STBY>::output();														// not sure if the standby is needed, but 
+	Pin<STBY>::high();															// it needs to be a high level for the tb6612 chip
+
+	subscribe_PCINT(FRNT, &PUSHER::sensor_cb, this, SENSOR_LOCK);				// the pusher has two sensors to detect the position
+	subscribe_PCINT(BACK, &PUSHER::sensor_cb, this, SENSOR_LOCK);				// back and front. it is needed for driving the motor
+
+	if (Pin<BACK>::read() == 0) position = 3;									// if the back sens is raised, we have a stable position
+
+	operate = 3;																// we start in returning mode			
+	brake_lead = BRAKE_LEAD;
+	brake_plan = 0;
+	run_pwm = 255;
+	rate_for = 0;
+	held = 0;
+	recovered = 0;
+	dart_cb = 0;
+}
+
+PUSHER_T
+void PUSHER::set_dart_callback(void(*callback)(void *arg, uint32_t time), void *arg) {
+	dart_cb = callback;
+	dart_arg = arg;
+}
+
+PUSHER_T
+void PUSHER::set_speed(uint8_t speed) {
+	analogWrite(PWM, speed);													// standard arduino function for PWM
+}
+PUSHER_T
+void PUSHER::start() {
+	operate = 1;																// we need to set the operateing mode
+	start_at = get_micros();
+	round = 0;																	// reset the round counter while we are started
+	if (brake_plan == 1) {														// started again before the predicted brake point
+		clear_alarm();
+		brake_plan = 0;
+	}
+	dbg_p << F("P::set start ") << _TIME << '\n';								// some debug
+}
+PUSHER_T
+void PUSHER::stop() {
+	if ((operate >= 3) && (operate != 6)) return;								// we are already in stopping mode
+	if ((*mode) && (round < *mode)) return;										// don't now, while count is in use and not complete
+	if (operate == 6) {															// holding between two darts, the brake is on already
+		if (position == 3) {
+			operate = 4;														// still on the back sensor, release is done in poll()
+		} else {																// slipped over the back sensor while braking, return the motor
+			operate = 3;
+			set_speed(100);
+			Pin<IN1>::low();
+			Pin<IN2>::high();
+		}
+		dbg_p << F("P::stop while holding ") << _TIME << '\n';
+		return;
+	}
+	operate = 3;																// enter go back mode
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if ((position == 2) && !brake_predict(get_micros())) {					// front sensor is left already, the sensor isr won't predict the brake point
+			Pin<IN1>::high();													// brake point passed, short break like in the pcint function
+			Pin<IN2>::high();
+			timer.set(100);
+		}
+	}
+	dbg_p << F("P::stop needed ") << _TIME << '\n';								// some debug
+}
+
+PUSHER_T
+uint8_t PUSHER::running() {
+	return (operate) ? 1 : 0;
+}
+
+PUSHER_T
+uint8_t PUSHER::latency(uint32_t *us) {
+	if (!motor_new) return 0;
+	motor_new = 0;
+	*us = motor_lat;
+	return 1;
+}
+
+PUSHER_T
+void PUSHER::poll() {
+	/* start() and stop() can be called from the trigger isr and callback() runs in the sensor isr, so one step of
+	** the state machine must not be interrupted. most passes have nothing to do, idle() finds that out without masking
+	** the interrupts, an isr changing the state right after it costs one pass */
+	if (idle()) return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		step();
+	}
+}
+
+PUSHER_T
+uint8_t PUSHER::idle() {
+	/* same early returns as step(), the timer is asked by completed() as done() would consume it */
+	uint8_t op = operate;
+	if (op == 0) return 1;
+	else if (op == 1) return (*enable != 1);
+	else if (op == 2) return !((*mode) && (round >= *mode));
+	else if (op == 3) {
+		if (position == 0) return 0;
+		if (position != 2) return 1;
+		return (brake_plan == 1) || (timer.completed() == 2);
+	} else if (op == 4) return (timer.completed() == 2);
+	else if (op == 6) {
+		uint8_t back = (recovered) ? *recovered : 0;
+		if ((!back) && (timer.completed() == 2)) return 1;
+		return (*enable != 1);
+	}
+	return 0;
+}
+
+PUSHER_T
+void PUSHER::step() {
+
+	// 0 inactive, 1 starting, 2 running, 3 returning, 4 breaking, 5 stopping
+	if (operate == 1) {							// indicates that the pusher needs to be started
+
+		if (*enable != 1) return;												// launcher is not up to speed
+
+		set_speed(rate_pwm());													// full speed or the speed for the set rate
+		Pin<IN1>::high();														// start the motor
+		Pin<IN2>::low();
+		operate = 2;															// and indicate that we are in operate mode
+		motor_lat = get_micros() - start_at;									// includes the flywheel spin-up on a cold start
+		motor_new = 1;
+		dbg_p << F("P::started ") << _TIME << '\n';
+
+
+	} else if (operate == 2) {					// pusher runs, check count mode
+
+		if ((*mode) && (round >= *mode)) {										// check if we are in count mode and reached the target
+			stop();																// slow down and start stop operation
+			dbg_p << F("P::reached count: ") << round << ' ' << _TIME << '\n';	// some debug
+		}
+
+
+	} else if (operate == 3) {					// pusher is in return mode					
+		// several actions are started within the pcint function
+
+		if (position == 0) {					// unknown position is indicated while just booted, so we start the motor to get a postion via the position sensors
+
+			set_speed(160);														// set a slow speed
+			Pin<IN1>::high();													// start the motor to get a default position
+			Pin<IN2>::low();
+			Pin<STBY>::high();													// as we start the sketch with position = 0 and operate = 3 (return mode)
+			position = 10;														// set position to unknown but with motor started
+			dbg_p << F("P::no position, get one ") << _TIME << '\n';			// some debug
+
+		} else if (position == 2) {				// we left the front sensor, the short break is done within the pcint function 
+
+			if (brake_plan == 1) return;										// the alarm brakes on the predicted point
+			if (!timer.done()) return;											// pcint has a timer set to slowdown the motor
+
+			set_speed(80);														// set a slow speed
+			Pin<IN1>::high();													// start the motor again
+			Pin<IN2>::low();
+			position = 12;														// set a new position status
+			dbg_p << F("P::break done, motor on slow speed ") << _TIME << '\n';	// some debug
+
+		}
+
+
+	} else if (operate == 4) {					// pusher is in breaking mode
+		// wait for finishing the stopping time and check if we are at the right position 
+		// if we are too far, we see pos 4 in the pcint function and can return the motor there
+
+		if (!timer.done()) return;
+
+		Pin<IN1>::low();														// release motor 
+		Pin<IN2>::low();
+
+		if (position == 3) {					// we are at the right position 
+			operate = 5;														// indicate finish
+			brake_plan = 0;
+			dbg_p << F("P::stopped at the right position ") << _TIME << '\n';	// some debug
+
+		} else if ((brake_plan == 2) && (position == 2)) {	// predicted brake stopped the disc before the back sensor
+			brake_learn(-1);
+			operate = 3;														// creep on to the back sensor
+		}
+
+
+	} else if (operate == 5) {					// pusher is stopped
+		dbg_p << F("P::finish stop, wait for action ") << _TIME << '\n';
+		operate = 0;															// set operating mode to inactive
+		round = 0;																// and reset the round counter
+
+
+	} else if (operate == 6) {					// pusher holds between two darts, the flywheels recover meanwhile
+
+		uint8_t back = (recovered) ? *recovered : 0;
+		if ((!back) && (!timer.done())) return;									// flywheels not back and hold time not over
+		if (*enable != 1) return;												// launcher is not up to speed
+
+		set_speed(run_pwm);														// go on with the next dart
+		Pin<IN1>::high();
+		Pin<IN2>::low();
+		operate = 2;
+		dbg_p << F("P::hold done ") << _TIME << '\n';
+	}
+
+}
+
+PUSHER_T
+void PUSHER::callback(uint8_t pin_def, uint8_t level, uint32_t time) {
+	/* ISR-SAFE: this is the pc interrupt function to detect the status of the front and back sensor. only what can't
+	** wait for the main loop is done here, everything else is done in event() on the queued pin change event.
+	** one turn of the pusher disc has several stati, here we are handling 1 front, 2 after front, 3 back and 4 after back sensor
+	** on status 1 we count the pushed darts and decide the stop in count mode
+	** on status 2 we start to slow down the motor if stop is required
+	** on status 3 we stop the motor if stop is required
+	** on status 4 we returning the motor if a stop is required because we have overrun the stop at the back sensor	*/
 
+	/* back sensor handling, edges are debounced already */
+	if (pin_def == BACK) {
+
+		if (!level) {															// we are at the back sensor 
+			position = 3;														// set the position flag
+			if (operate == 3) {													// if we are in returning mode, we should have a slow motor and reached now the end position
+				if (brake_plan == 1) {											// predicted brake point not reached yet, too late
+					clear_alarm();
+					brake_learn(1);
+				}
+				operate = 4;													// set the new operate mode - breaking
+				Pin<IN1>::high();												// set breaking mode on motor
+				Pin<IN2>::high();
+				timer.set(200);													// and some time for slowing down, follow up is in the poll function
+
+			} else if ((operate == 2) && (*recover) && ((!recovered) || (!*recovered))) {	// more darts to come, hold the dart back till the flywheels recovered
+				operate = 6;
+				held = 1;
+				Pin<IN1>::high();
+				Pin<IN2>::high();
+				timer.set(*recover);											// follow up is in the poll function
+			}
+
+		} else {																// back sensor left
+			position = 4;														// remember the position
+			back_left = time;
+			if (operate == 4) {													// seems we are slipped over the back sensor, so we return the motor
+				if (brake_plan == 2) brake_learn(1);							// braked too late
+				operate = 3;													// we are in returning mode
+				set_speed(100);													// set a slow speed
+				Pin<IN1>::low();												// start the motor in the oposite direction again 
+				Pin<IN2>::high();
+			}
+		}
+	}
+
+
+	/* front sensor handling */
+	if (pin_def == FRNT) {
+
+		if (!level) {															// we are at the front sensor 
+			position = 1;														// remember the position
+			round++;															// increase the round counter (darts pushed)
+			if (!held) cruise = (time - back_left < 0xffff) ? time - back_left : 0;	// back left to front reached, 0 if too slow, a stroke from a hold keeps the last
+			frnt_in = time;
+			if (dart_cb) dart_cb(dart_arg, time);								// launcher models the flywheel speed loss
+			if ((operate == 2) && (*mode) && (round >= *mode)) operate = 3;		// count reached, return mode, so the motor brakes when the front sensor is left
+
+		} else {																// front sensor left
+			position = 2;														// set the new position
+			frnt_out = time;
+			if ((operate == 3) && !brake_predict(time)) {						// with the speed known the alarm brakes, otherwise we are breaking the motor
+				Pin<IN1>::high();												// for some time and start it slower to return to the next position
+				Pin<IN2>::high();												// set breaking mode of tb6612 chip
+				timer.set(100);													// set some time, follow up is in main loop
+			}
+		}
+	}
+
+}
+
+/* the angle from the front to the back sensor is the same as from the back sensor to the front sensor, so at the same
+** speed it takes cruise us. braking brake_lead before the center of the back sensor stops the disc on it. the main loop
+** may be busy with the display for some ms, so the brake is set by the alarm isr */
+PUSHER_T
+uint8_t PUSHER::brake_predict(uint32_t now) {
+	int32_t brake_at = (int32_t)cruise + (int32_t)(frnt_out - frnt_in) / 2 - brake_lead - (int32_t)(now - frnt_out);
+	if ((!cruise) || (brake_at <= 0)) return 0;									// speed unknown or too late for it
+	brake_plan = 1;
+	set_alarm(brake_at, &PUSHER::brake_cb, this);
+	return 1;
+}
+
+PUSHER_T
+void PUSHER::brake() {
+	if ((operate != 3) || (position != 2) || (brake_plan != 1)) return;			// back sensor was faster or the pusher started again
+	Pin<IN1>::high();
+	Pin<IN2>::high();
+	brake_plan = 2;
+	operate = 4;
+	uint32_t hold = (uint32_t)brake_lead * 4;
+	timer.set_us((hold < BRAKE_MIN) ? BRAKE_MIN : hold);						// follow up is in the poll function
+}
+
+/* the brake point is predicted from the sensor transit times, brake_lead is the part which depends on the motor and the
+** brake. it is corrected by 1/8 on every stop which was not on the back sensor */
+PUSHER_T
+void PUSHER::brake_learn(int8_t late) {
+	uint16_t step = brake_lead / 8 + 100;
+	if (late > 0) brake_lead = (brake_lead + step > 30000) ? 30000 : brake_lead + step;
+	else brake_lead = (brake_lead < 1000 + step) ? 1000 : brake_lead - step;
+	brake_plan = 0;
+}
+
+/* the disc speed follows the pwm, a new rate starts with the pwm scaled from the last one or from the full speed rate */
+PUSHER_T
+uint8_t PUSHER::rate_pwm() {
+	if (!*rate) return 255;														// no rate set, full speed
+	if (rate_for == *rate) return run_pwm;										// already measured for this rate
+
+	uint16_t pwm = (rate_for) ? (uint16_t)run_pwm * *rate / rate_for : 255 * *rate / PUSHER_DPS;
+	run_pwm = (pwm > 255) ? 255 : (pwm < PUSHER_PWM_MIN) ? PUSHER_PWM_MIN : pwm;
+	rate_for = *rate;
+	return run_pwm;
+}
+
+/* the dart interval is proportional to 1 / pwm, so the measured interval gives the pwm for the target interval.
+** half of the step is applied per dart, the dart load and the battery sag make single intervals jumpy */
+PUSHER_T
+void PUSHER::rate_adjust(uint32_t period) {
+	uint32_t target = 1000000UL / *rate;
+	uint32_t want = (uint32_t)run_pwm * period / target;
+	if (want > 255) want = 255;
+	int16_t pwm = run_pwm + ((int16_t)want - run_pwm) / 2;
+	run_pwm = (pwm < PUSHER_PWM_MIN) ? PUSHER_PWM_MIN : pwm;
+	rate_for = *rate;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (operate == 2) set_speed(run_pwm);									// the sensor isr may have started the stop meanwhile
+	}
+	dbg_p << F("P::rate ") << period << F("us, pwm ") << run_pwm << ' ' << _TIME << '\n';
+}
+
+PUSHER_T
+void PUSHER::event(const s_pcint_event &ev) {
+	/* main loop part of the sensor handling, works on the queued pin change events. sensor transit times and debug */
+
+	uint8_t bit = Pin<FRNT>::bit;
+	if ((Pin<FRNT>::vec == ev.vec) && (ev.chng & bit) && !(ev.level & bit)) {					// front sensor reached, dart pushed
+		if (ev.time - frnt_time >= SENSOR_LOCK) {
+			dbg_p << F("P::dart ") << round << F(", back->front ") << (ev.time - back_time) << F("us ") << _TIME << '\n';
+			if ((operate == 2) && (round > 1) && (*rate) && !held) rate_adjust(ev.time - frnt_time);
+			held = 0;
+			frnt_time = ev.time;
+		}
+	}
+
+	bit = Pin<BACK>::bit;
+	if ((Pin<BACK>::vec == ev.vec) && (ev.chng & bit) && !(ev.level & bit)) {					// back sensor reached
+		if (ev.time - back_time >= SENSOR_LOCK) {
+			dbg_p << F("P::back, front->back ") << (ev.time - frnt_time) << F("us ") << _TIME << '\n';
+			back_time = ev.time;
+		}
+	}
+}
+
+
+PUSHER_T
+void PUSHER::sensor_cb(void *obj, uint8_t pin_def, uint8_t level, uint32_t time) {
+	static_cast<PUSHER*>(obj)->callback(pin_def, level, time);					// subscribed to both sensor pins
+}
+
+PUSHER_T
+void PUSHER::brake_cb(void *obj) {
+	static_cast<PUSHER*>(obj)->brake();											// alarm of the predicted brake point
+}
+
+
+LAUNCHER_T
+LAUNCHER::LauncherClass(uint16_t min_speed, uint16_t max_speed, uint16_t max_rpm) : min_speed(min_speed), max_speed(max_speed), max_rpm(max_rpm) {
+	ready = 0;
+	tach_time = 0;
+	tach_period = 0xffff;
+	tach_limit = 0;
+	tach_ready = 0;
+	battery = 0;
+	spin_addr = 0;
+	spin_idx = 0xff;
+	spin_dirty = 0;
+	save_pos = LEARN_SIZE;
+	recovered = 1;
+	droop = 0;
+	droop_time = 0;
+	ramp = 0;
+	volt = 0;
+	out_speed = 0;
+	curve_dirty = 0;
+	fire_time = 0;
+	for (uint8_t i = 0; i < THROTTLE_POINTS; i++) curve[i] = (uint32_t)(max_speed - min_speed) * i / (THROTTLE_POINTS - 1);	// linear till calibrated
+	standby_ms = 0;
+	standby_set = 0;
+	standby_start = 0;
+	ramp_idx = RAMP_STEPS;
+	ramp_timer.set_callback(&LAUNCHER::ramp_cb, this);
+	timer.set_callback(&LAUNCHER::timer_cb, this);								// the state machine is driven by the timer service
+	droop_timer.set_callback(&LAUNCHER::droop_cb, this);
+}
+
+LAUNCHER_T
+void LAUNCHER::init() {
+	myServo.attach(ESC, min_speed, max_speed);									// attaches the servo pin to the servo object
+	myServo.writeMicroseconds(0);												// and set it off
+
+	if (TACH != NO_PIN) {
+		subscribe_PCINT(TACH, &LAUNCHER::tach_cb, this, TACH_LOCK);				// flywheel speed, measured in the isr
+		quiet_PCINT(TACH);														// too fast for the event queue
+	}
+
+	dbg_l << F("L::init, min_speed: ") << min_speed << F(", max_speed: ") << max_speed << ' ' << _TIME << '\n';
+}
+LAUNCHER_T
+void LAUNCHER::start() {
+
+	set_speed = throttle(*fire_speed);											// pulse width for the fire speed at the current battery voltage
+
+	/* standby statistics, a standby without a shot makes the next one shorter, a shot within one more standby time after
+	** the standby ended says it was too short. the window starts when the standby speed is reached, the ramp down before
+	** doesn't count. a pre-rev runs through the same standby, so it adapts the same way */
+	if (((mode == 10) || (mode == 0)) && (standby_start) && (get_millis() - standby_start < 2UL * standby())) {
+		standby_ms = (standby_ms + standby_ms / 4 > STANDBY_MAX) ? STANDBY_MAX : standby_ms + standby_ms / 4;
+		dbg_l << F("L::standby too short, now ") << standby_ms << F("ms ") << _TIME << '\n';
+	}
+	standby_start = 0;
+
+	/* state machine modes: 0 = stopped, 10 = stopping, 1 = standby (reduced speed), 
+	** 11 = going to standby speed, 2 = fire speed, 12 = accelerating to fire speed */
+	uint16_t set_timer;															// generate a variable to store the speedup time against different circumsdances
+	if (mode == 0) set_timer = *speedup_time;									// coming from stopped, full time needed
+	else if (mode == 2) set_timer = 0;											// we are already in fire mode, no additional time needed
+	else set_timer = *speedup_time / 2;											// standby, decrease to standby or accelerating to fire, not the fulltime needed
+
+	spin_idx = spinup_index();													// learned time for this start, if there is one
+	if (spin_idx != 0xff) {
+		uint8_t learned = spin[spin_idx];
+		if ((learned) && (learned != 0xff)) set_timer = learned * SPINUP_UNIT + learned * SPINUP_UNIT / 8;	// some margin on top
+	}
+	spin_start = get_micros();
+	spin_time = 0;
+
+	if (mode != 2) {															// new spin-up, nothing left from the darts before
+		droop = 0;
+		recovered = 1;
+	}
+
+	tach_limit = 0;
+	if ((TACH != NO_PIN) && (max_rpm) && (*fire_speed)) {						// tach period which is close enough to the target rpm
+		uint32_t target = (uint32_t)max_rpm * *fire_speed / 100 * (100 - TACH_TOLERANCE) / 100;
+		uint32_t limit = 60000000UL / TACH_PPR / target;
+		tach_limit = (limit > 0xfffe) ? 0xfffe : limit;
+	}
+
+	mode = 12;																	// set state machine to 'accelerating to fire speed'
+	tach_ready = 0;
+	ramp_from = (out_speed > min_speed) ? out_speed : min_speed;				// ramp from the current speed, the flywheel may still turn
+	if ((ramp) && (*ramp) && (*ramp <= RAMP_PROFILES) && (set_speed > ramp_from)) {
+		ramp_idx = 0;
+		ramp_next();															// first step now, the others follow by the ramp timer
+	} else {
+		ramp_idx = RAMP_STEPS;
+		write(set_speed);														// and write the new speed into the esc
+	}
+	arm(set_timer);																// set the timer accordingly, with a tach it is the upper limit
+
+	dbg_l << F("L::set start, speed: ") << *fire_speed << F(", set_speed: ") << set_speed << F(", speedup_time: ") << *speedup_time << F(", set_timer: ") << set_timer << ' ' << _TIME << '\n';
+}
+LAUNCHER_T
+void LAUNCHER::stop() {
+	/* stop means, we are reducing the speed of the launcher to a standby level for a certain time
+	** here we are setting a new status of the state machine */
+
+	if ((mode == 2) && (TACH != NO_PIN) && (max_rpm) && (get_millis() - fire_time >= THROTTLE_SETTLE)) throttle_learn();
+
+	if (set_speed) set_speed = throttle(*standby_speed);						// calculate the standby speed 				
+
+	/* state machine modes: 0 = stopped, 10 = stopping, 1 = standby (reduced speed),
+	** 11 = going to standby speed, 2 = fire speed, 12 = accelerating to fire speed */
+	uint16_t set_timer = *speedup_time / 2;										// we need some time to slow down
+
+	ready = 0;																	// indicate the pusher that he cannot fire
+	mode = 11;																	// we are going to standby speed
+	ramp_idx = RAMP_STEPS;														// a running ramp ends here
+	write(set_speed);															// write the new speed into the esc
+	arm(set_timer);																// set the timer accordingly
+
+	dbg_l << F("L::set stop, speed: ") << *standby_speed << F(", set_speed: ") << set_speed << F(", set_timer: ") << set_timer << ' ' << _TIME << '\n';
+}
+
+LAUNCHER_T
+void LAUNCHER::poll() {
+	/* state machine modes: 0 = stopped, 10 = stopping, 1 = standby (reduced speed),
+	** 11 = going to standby speed, 2 = fire speed, 12 = accelerating to fire speed */
+
+	if (!timer.done()) return;													// waiting for a finished timer, leave
+
+
+	if (mode == 12) {				// accelerating to fire														
+		/* triggered in the start function, if we are here the start time has finished already */
+		ready = 1;																// signalize the pusher that he is allowed to fire
+		mode = 2;																//set status to 'fire speed'
+		fire_time = get_millis();
+		spinup_learn();															// compare the spin-up with the table
+		dbg_l << F("L::accelerate done ") << _TIME << '\n';
+
+
+	} else if (mode == 11) {		// reducing speed to standby mode
+		/* triggered in the stop function, if we are here the stop time has finsished */
+		mode = 1;																// set status 'standby' - we are on reduced speed
+		standby_start = get_millis();
+		dbg_l << F("L::standby for ") << standby()  << F("ms ") << _TIME << '\n';
+		arm(standby());															// set the standby timer
+
+
+	} else if (mode == 1) {			// standby time is over
+		/* triggered by the state machine itself, standby is over, we need to stop the motor */
+		uint16_t set_timer = *speedup_time / 2;									// calculate the time for the stop process
+		standby_ms = (standby_ms - standby_ms / 8 < STANDBY_MIN) ? STANDBY_MIN : standby_ms - standby_ms / 8;	// no shot came, shorter next time
+		write(0);																// set the esc to stop
+		mode = 10;																// set the status to stopping mode
+		dbg_l << F("L::stopping for ") << set_timer << F("ms ") << _TIME << '\n';
+		arm(set_timer);															// set the timer accordingly
+
+
+	} else if (mode == 10) {		// stopping mode
+		/* triggered by the state machine itself, stopping time is over, we have a new status */
+		mode = 0;																// we are stopped, save() writes the learned data from now on
+		dbg_l << F("L::stopped!") << _TIME << '\n';
+
+	}
+}
+
+LAUNCHER_T
+uint8_t LAUNCHER::service() {
+#if defined(LAUNCHER_DSHOT)
+	return myServo.service();													// repeat the dshot frame
+#else
+	return 0;																	// the servo library runs on its own timer
 #endif
+}
+
+LAUNCHER_T
+uint16_t LAUNCHER::rpm() {
+	if (TACH == NO_PIN) return 0;
+	uint32_t time;
+	uint16_t period;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		time = tach_time;
+		period = tach_period;
+	}
+	if ((period == 0xffff) || (get_micros() - time > 0xffff)) return 0;		// no pulse for a while, flywheel stands
+	return 60000000UL / TACH_PPR / period;
+}
+
+/* pre-rev on a hint from the sketch, the standby after it adapts like the one after a shot */
+LAUNCHER_T
+void LAUNCHER::prerev() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {											// start() and stop() may come from the trigger isr
+		if ((mode == 2) || (mode == 12)) return;								// fire speed already
+		if (mode == 1) {														// standby, start the standby time again
+			arm(standby());
+			standby_start = get_millis();
+			return;
+		}
+		if (mode == 11) return;													// going to standby, the standby time follows
+		set_speed = throttle(*standby_speed);
+		dbg_l << F("L::pre-rev ") << _TIME << '\n';
+		stop();																	// same way to standby as after a shot
+	}
+}
+
+LAUNCHER_T
+uint16_t LAUNCHER::standby() {
+	if (!*standby_time) return 0;												// no standby, stop right after the shot
+	if (*standby_time != standby_set) {											// changed in the menu, adapt from the new value
+		standby_set = *standby_time;
+		standby_ms = (standby_set < STANDBY_MIN) ? STANDBY_MIN : standby_set;
+	}
+	return standby_ms;
+}
+
+LAUNCHER_T
+uint8_t LAUNCHER::running() {
+	return (mode) ? 1 : 0;
+}
+
+LAUNCHER_T
+void LAUNCHER::write(uint16_t speed) {
+	out_speed = speed;
+	myServo.writeMicroseconds(speed);
+}
+
+/* one step of the spin-up profile, the last step writes the target */
+LAUNCHER_T
+void LAUNCHER::ramp_next() {
+	if (ramp_idx >= RAMP_STEPS) return;											// ramp ended or was cut by stop()
+	uint8_t share = pgm_read_byte(&ramp_table[*ramp - 1][ramp_idx]);
+	if (++ramp_idx >= RAMP_STEPS) {
+		write(set_speed);
+		return;
+	}
+	write(ramp_from + ((uint32_t)(set_speed - ramp_from) * share >> 8));
+	ramp_timer.set(RAMP_STEP);
+}
+
+LAUNCHER_T
+void LAUNCHER::ramp_cb(void *obj) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {											// start() and stop() may come from the trigger isr
+		static_cast<LAUNCHER*>(obj)->ramp_next();
+	}
+}
+
+LAUNCHER_T
+void LAUNCHER::learn(uint16_t addr) {
+	spin_addr = addr;
+	if (TACH != NO_PIN) get_eeprom(spin_addr, SPINUP_SIZE, spin);				// the table area stays reserved without a tach
+
+	uint16_t stored[THROTTLE_POINTS];											// take the curve only if it is a plausible one
+	get_eeprom(spin_addr + SPINUP_SIZE, THROTTLE_SIZE, stored);
+	if (!stored[THROTTLE_POINTS - 1]) return;									// cleared
+	for (uint8_t i = 1; i < THROTTLE_POINTS; i++) {
+		if ((stored[i] < stored[i - 1]) || (stored[i] > max_speed - min_speed)) return;	// erased or broken
+	}
+	memcpy(curve, stored, THROTTLE_SIZE);
+}
+
+/* called by a background task of the sketch, outside of any atomic block. an eeprom write takes 3.4ms, so only one
+** byte per call and only if the eeprom is ready, the loop never waits for it. the curve lies behind the table, both are
+** written as one block. a change meanwhile starts over, stop() may learn the curve in the trigger isr */
+LAUNCHER_T
+uint8_t LAUNCHER::save() {
+	if ((!spin_addr) || (mode) || (!ready_eeprom())) return 0;					// nothing learned, flywheels running or eeprom busy
+	if (save_pos >= LEARN_SIZE) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			if ((TACH != NO_PIN) && (spin_dirty)) save_pos = 0;
+			else if (curve_dirty) save_pos = SPINUP_SIZE;
+			spin_dirty = 0;
+			curve_dirty = 0;
+		}
+		if (save_pos >= LEARN_SIZE) return 0;
+	}
+
+	while (save_pos < LEARN_SIZE) {												// reading is fast, skip what is stored already
+		uint8_t i = save_pos++, b;
+		uint8_t *v = (i < SPINUP_SIZE) ? &spin[i] : (uint8_t*)curve + i - SPINUP_SIZE;
+		get_eeprom(spin_addr + i, 1, &b);
+		if (b == *v) continue;
+		set_eeprom(spin_addr + i, 1, v);
+		break;
+	}
+	return 1;
+}
+
+/* the curve is linear between the points, the flywheel speed follows throttle times battery voltage */
+LAUNCHER_T
+uint16_t LAUNCHER::throttle(uint8_t percent) {
+	if (!percent) return 0;														// esc off
+	if (percent > 100) percent = 100;
+
+	const uint8_t span = 100 / (THROTTLE_POINTS - 1);
+	uint8_t i = percent / span;
+	if (i >= THROTTLE_POINTS - 1) i = THROTTLE_POINTS - 2;
+	uint32_t rel = curve[i] + (uint32_t)(curve[i + 1] - curve[i]) * (percent - i * span) / span;
+
+	if ((volt) && (*volt)) rel = rel * VOLT_REF / *volt;						// sagging battery, more throttle
+	if (rel > (uint16_t)(max_speed - min_speed)) rel = max_speed - min_speed;	// full throttle is the limit
+	return min_speed + rel;
+}
+
+/* the rpm follows the throttle, so measured and target rpm give the throttle for the target. the two points around
+** fire_speed move by 1/4 of it, weighted by the distance */
+LAUNCHER_T
+void LAUNCHER::throttle_learn() {
+	uint16_t measured = rpm();
+	if ((!measured) || (set_speed >= max_speed)) return;						// no speed or full throttle, nothing to learn
 
+	const uint8_t span = 100 / (THROTTLE_POINTS - 1);
+	uint8_t i = *fire_speed / span;
+	if (i >= THROTTLE_POINTS - 1) i = THROTTLE_POINTS - 2;
+	uint8_t w = *fire_speed - i * span;											// weight of the upper point
+
+	uint32_t rel = set_speed - min_speed;										// throttle at VOLT_REF, the same what the battery voltage did to it
+	if ((volt) && (*volt)) rel = rel * *volt / VOLT_REF;
+	uint32_t target = (uint32_t)max_rpm * *fire_speed / 100;
+	int32_t step = ((int32_t)(rel * target / measured) - (int32_t)rel) / 4;
+	if (!step) return;
+
+	for (uint8_t k = 0; k < 2; k++) {
+		int32_t v = (int32_t)curve[i + k] + step * ((k) ? w : span - w) / span;
+		curve[i + k] = (v < 0) ? 0 : (v > max_speed - min_speed) ? max_speed - min_speed : v;
+	}
+	for (uint8_t k = 1; k < THROTTLE_POINTS; k++) {								// keep it rising
+		if (curve[k] < curve[k - 1]) curve[k] = curve[k - 1];
+	}
+	curve_dirty = 1;
+	dbg_l << F("L::throttle ") << *fire_speed << F("%, ") << measured << F(" of ") << target << F("rpm, curve ") << curve[i] << ' ' << curve[i + 1] << ' ' << _TIME << '\n';
+}
+
+/* table entry for a start in the current launcher state, 0xff if there is no table or the launcher is at fire speed already */
+LAUNCHER_T
+uint8_t LAUNCHER::spinup_index() {
+	if ((TACH == NO_PIN) || (!spin_addr)) return 0xff;							// nothing learned without a tach
+
+	uint8_t state;
+	if (mode == 0) state = 0;													// stopped
+	else if ((mode == 1) || (mode == 11)) state = 1;							// standby speed or going there
+	else if (mode == 10) state = 2;												// stopping, flywheel still turns
+	else return 0xff;															// fire speed or accelerating to it
+
+	uint8_t speed = (*fire_speed < 50) ? 0 : (*fire_speed > 100) ? 50 : *fire_speed - 50;
+	speed = speed * SPINUP_SPEEDS / 51;
+	uint8_t level = (battery) ? *battery * SPINUP_LEVELS / 101 : SPINUP_LEVELS / 2;
+	if (level >= SPINUP_LEVELS) level = SPINUP_LEVELS - 1;
+
+	return (state * SPINUP_SPEEDS + speed) * SPINUP_LEVELS + level;
+}
+
+/* learn from the tach, the measured time goes with 1/4 into the entry. without the target rpm in time the entry was
+** too short, it grows by 1/4 then */
+LAUNCHER_T
+void LAUNCHER::spinup_learn() {
+	if ((TACH == NO_PIN) || (spin_idx == 0xff)) return;
+	uint8_t *e = &spin[spin_idx];
+	uint8_t known = (*e) && (*e != 0xff);
+	uint16_t value;
+
+	if (tach_ready) {															// target rpm reached, spin_time is valid
+		uint16_t measured = (spin_time / 1000 + SPINUP_UNIT - 1) / SPINUP_UNIT;
+		value = (known) ? (*e * 3 + measured + 3) / 4 : measured;
+	} else if (known) {															// timer ran out first
+		value = *e + *e / 4 + 1;
+	} else return;																// speedup_time was used, nothing learned
+
+	if (!value) value = 1;
+	if (value > 0xfe) value = 0xfe;
+	if (value == *e) return;
+	*e = value;
+	spin_dirty = 1;
+	dbg_l << F("L::learned ") << spin_idx << ' ' << value * SPINUP_UNIT << F("ms ") << _TIME << '\n';
+}
+
+LAUNCHER_T
+void LAUNCHER::arm(uint16_t ms) {
+	if (ms) timer.set(ms);														// next step is dispatched by the timer service
+	else timer.set_us(1);														// no time needed, next step with the next timers.poll()
+}
+
+LAUNCHER_T
+void LAUNCHER::timer_cb(void *obj) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {											// start() and stop() may come from the trigger isr
+		static_cast<LAUNCHER*>(obj)->poll();
+	}
+}
+
+LAUNCHER_T
+void LAUNCHER::tach_cb(void *obj, uint8_t, uint8_t level, uint32_t time) {
+	/* ISR-SAFE: one falling edge per pulse, the period is compared against the limit from start(), no division here */
+	if (level) return;
+	LAUNCHER *l = static_cast<LAUNCHER*>(obj);
+	uint32_t period = time - l->tach_time;
+	l->tach_time = time;
+	l->tach_period = (period > 0xffff) ? 0xffff : period;
+
+	if ((l->mode == 2) && (l->tach_limit)) l->recovered = (l->tach_period <= l->tach_limit);	// droop after a dart
+
+	if ((l->mode != 12) || (l->tach_ready) || (!l->tach_limit)) return;
+	if (l->tach_period > l->tach_limit) return;									// not up to speed yet
+	l->tach_ready = 1;
+	l->spin_time = time - l->spin_start;
+	l->arm(0);																	// up to speed, the state machine goes on with the next timers.poll()
+}
+
+/* without a tach the speed loss is modelled, every dart takes DROOP_DART and the esc halves the deficit every DROOP_HALF
+** ms. the time till the deficit is within TACH_TOLERANCE is counted in halvings, the last one is taken as linear */
+LAUNCHER_T
+void LAUNCHER::dart(uint32_t time) {
+	/* ISR-SAFE: called by the pusher sensor isr, no division on the way */
+	if (mode != 2) return;
+	fire_time = get_millis();													// speed is disturbed, no throttle calibration for now
+	if ((TACH != NO_PIN) && (tach_limit)) return;								// the tach measures it
+
+	const uint32_t half = DROOP_HALF * 1000UL;
+	const uint16_t tol = TACH_TOLERANCE * 10;
+	uint32_t elapsed = time - droop_time;
+	droop_time = time;
+
+	uint16_t d = droop;															// what is left from the darts before
+	while ((d) && (elapsed >= half)) {
+		d >>= 1;
+		elapsed -= half;
+	}
+	if ((d) && (elapsed > half / 2)) d -= d / 4;								// linear part of the next halving in quarters
+	droop = d = d + DROOP_DART;
+	if (d <= tol) return;
+
+	uint32_t wait = 0;
+	while ((d >> 1) > tol) {
+		d >>= 1;
+		wait += half;
+	}
+	wait += (d - tol > d / 4) ? half : half / 2;								// last halving, d is between tol and 2 * tol
+	recovered = 0;
+	droop_timer.set_us(wait);
+}
+
+LAUNCHER_T
+void LAUNCHER::dart_cb(void *obj, uint32_t time) {
+	static_cast<LAUNCHER*>(obj)->dart(time);
+}
+
+LAUNCHER_T
+void LAUNCHER::droop_cb(void *obj) {
+	static_cast<LAUNCHER*>(obj)->recovered = 1;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
+
+#endif
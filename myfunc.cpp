@@ -12,7 +12,11 @@
 /**
 * @brief Constructor to initialize waittimer
 */
-waittimer::waittimer() {
+waittimer::waittimer() : startTime(0), checkTime(0), micros(0), deadline(0), next(0), queued(0), fired(0), cb(0), cb_arg(0) {
+}
+
+waittimer::~waittimer() {
+	if (queued) timers.remove(this);														// never leave a dangling pointer in the queue
 }
 
 /**
@@ -22,10 +26,12 @@ waittimer::waittimer() {
 *         If the timer was never set(), return value is 1
 */
 uint8_t  waittimer::done(void) {
-	if (!checkTime) return 1;																// not armed, so nothing to do
-	if ((get_millis() - startTime) < checkTime) return 0;										// not ready yet
-	checkTime = 0;																			// if we are here, timeout was happened
-	return 1;																				// return a 1 for done
+	/* single byte flags only, an isr set() in between clears fired and queues the timer again, so no atomic block */
+	if (fired) {																			// the timer service saw the deadline
+		fired = 0;
+		return 1;
+	}
+	return (queued) ? 0 : 1;																// still waiting, or never armed
 }
 
 /**
@@ -36,31 +42,177 @@ uint8_t  waittimer::done(void) {
 void     waittimer::set(uint32_t wait_millis) {
 	uint8_t armed = (wait_millis) ? 1 : 0;
 	if (!armed) return;
+	micros = 0;
 	startTime = get_millis();
 	checkTime = wait_millis;
+	arm(wait_millis * 1000);
+}
+
+/**
+* @brief Start the timer in microsecond mode, for brake timings and sensor transits below a millisecond
+*
+* @param us Time until timer is done() (unit: us), max ~71 minutes
+*/
+void     waittimer::set_us(uint32_t wait_micros) {
+	if (!wait_micros) return;
+	micros = 1;
+	startTime = get_micros();
+	checkTime = wait_micros;
+	arm(wait_micros);
+}
+
+/**
+* @brief Register a function which is called by timers.poll() when the timer expires. the timer is disarmed before the
+*        callback runs, so the callback can set() it again.
+*/
+void     waittimer::set_callback(void(*callback)(void *arg), void *arg) {
+	cb = callback;
+	cb_arg = arg;
 }
 
 /**
 * @brief Query the remaing time until the timer is done
 *
-* @return Time until timer is done() (unit: ms)
+* @return Time until timer is done() (unit: ms, or us if armed by set_us())
 */
 uint32_t waittimer::remain(void) {
 	if (!checkTime) return 0;
-	return (checkTime - (get_millis() - startTime));
+	return (checkTime - (now() - startTime));
 }
 
 /* returns the status of the timer
 * 0 not active
-* 1 active and remaining time is 0 or below, but not progressed via done()
-* 2 active and remaining time is above 0 */
+* 1 active and expired, seen by the timer service, but not progressed via done()
+* 2 active and still queued, byte flags only like done() */
 uint8_t waittimer::completed(void) {
-	if (!checkTime) return 0;																// not armed, so return not active
-	else if ((get_millis() - startTime) >= checkTime) return 1;								// timer done, but not progressed
-	else return 2;																			// time not ready, need some additional time
+	if (fired) return 1;																	// timer done, but not progressed
+	else if (queued) return 2;																// time not ready, need some additional time
+	else return 0;																			// not armed, so return not active
+}
+
+/* time base the timer was armed with */
+uint32_t waittimer::now(void) {
+	return (micros) ? get_micros() : get_millis();
+}
+
+/* put the timer with its new deadline into the queue of the timer service */
+void     waittimer::arm(uint32_t wait_micros) {
+	fired = 0;
+	deadline = get_micros() + wait_micros;
+	timers.insert(this);
+}
+
+
+
+/*-- timer service --------------------------------------------------------------------------------------------------------
+* the queue is a single linked list sorted by deadline, head expires first. deadlines are compared as signed difference
+* so the wrap of the us clock is no problem as long as a timer is shorter than ~35 minutes.
+*/
+timerservice timers;
+
+/* called from the main loop, reads the clock once and handles every timer which has expired */
+void timerservice::poll(void) {
+	if (!head) return;																		// nothing armed
+	uint32_t now = get_micros();
+
+	while (1) {
+		waittimer *t;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {													// an isr could arm a timer meanwhile, so the
+			t = head;																		// timer is popped and flagged in one go
+			if ((t) && ((int32_t)(now - t->deadline) >= 0)) {
+				head = t->next;
+				t->queued = 0;
+				t->checkTime = 0;															// disarm, done() and completed() go by the flags
+				if (!t->cb) t->fired = 1;													// polled timer, done() will see it
+			} else t = 0;
+		}
+		if (!t) return;																		// head is in the future, all later ones as well
+		if (t->cb) t->cb(t->cb_arg);														// a set() from here on is a new deadline
+	}
+}
+
+/* sorted insert, a timer which is already queued is moved to its new position */
+void timerservice::insert(waittimer *t) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (t->queued) remove(t);
+		waittimer **pp = &head;
+		while ((*pp) && ((int32_t)(t->deadline - (*pp)->deadline) >= 0)) pp = &(*pp)->next;
+		t->next = *pp;
+		*pp = t;
+		t->queued = 1;
+	}
+}
+
+void timerservice::remove(waittimer *t) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (waittimer **pp = &head; *pp; pp = &(*pp)->next) {
+			if (*pp != t) continue;
+			*pp = t->next;
+			break;
+		}
+		t->queued = 0;
+	}
+}
+
+
+
+
+
+
+/*-- task scheduler -------------------------------------------------------------------------------------------------------
+* tasks are sorted by priority at add(), so run() can stop at the first background task which did some work.
+* the end stamp of one task is the start stamp of the next one, so every task costs one clock read for the statistic.
+*/
+taskscheduler tasks;
+
+void taskscheduler::add(uint8_t(*fn)(void), uint8_t prio, const __FlashStringHelper *name) {
+	if (cnt >= MAX_TASKS) return;
+	uint8_t i = cnt++;
+	while ((i) && (task[i - 1].prio > prio)) {												// keep the table sorted, same priority keeps the order of add()
+		task[i] = task[i - 1];
+		i--;
+	}
+	memset(&task[i], 0, sizeof(s_task));
+	task[i].fn = fn;
+	task[i].prio = prio;
+	task[i].name = name;
+}
+
+void taskscheduler::run(void) {
+	uint32_t stamp = get_micros();
+	uint8_t i = 0;
+
+	for (; (i < cnt) && (task[i].prio == 0); i++) exec(i, stamp);							// fire path, every pass
+	for (; i < cnt; i++) {																	// background, one slice per pass
+		if (exec(i, stamp)) break;
+	}
+}
+
+uint8_t taskscheduler::exec(uint8_t nr, uint32_t &stamp) {
+	uint8_t worked = task[nr].fn();
+	uint32_t now = get_micros();
+	if (worked) {
+		uint32_t dur = now - stamp;
+		if (dur > task[nr].max_us) task[nr].max_us = (dur > 0xffff) ? 0xffff : dur;
+		task[nr].sum_us += dur;
+		task[nr].runs++;
+	}
+	stamp = now;
+	return worked;
 }
 
+void taskscheduler::latency(uint32_t us) {
+	if (us > max_latency) max_latency = us;
+}
 
+void taskscheduler::report(Print &out) {
+	for (uint8_t i = 0; i < cnt; i++) {
+		out << task[i].name << F(" p") << task[i].prio << F(", runs: ") << task[i].runs << F(", max: ") << task[i].max_us;
+		out << F("us, avg: ") << ((task[i].runs) ? task[i].sum_us / task[i].runs : 0) << F("us\n");
+	}
+	out << F("trigger to pusher motor max: ") << max_latency << F("us\n");
+}
+//- -----------------------------------------------------------------------------------------------------------------------
 
 
 
@@ -129,12 +281,37 @@ struct  s_pcint_vector {
 	volatile uint8_t *PINREG;
 	uint8_t curr;
 	uint8_t chng;
-	uint8_t prev;
 	uint8_t mask;
-	uint32_t time;
+	uint8_t quiet;																			// pins which are not queued as events
 };
 volatile s_pcint_vector pcint_vector[pc_interrupt_vectors];									// define a struct for pc int processing
 
+/* every registered pin is debounced on its own. the first edge is taken immediately, further edges of the same pin are
+* ignored for the lockout time. if the pin settled on the other level within the lockout, check_PCINT() picks that up after it. */
+struct s_pcint_pin {
+	uint8_t pin_def;
+	uint8_t vec;
+	uint8_t bit;
+	uint8_t level;																			// debounced level
+	uint8_t event;																			// 2 falling, 3 rising, consumed by check_PCINT()
+	uint16_t lock;																			// lockout time in us after an accepted edge
+	uint32_t time;																			// get_micros() of the last accepted edge
+	pcint_handler handler;																	// optional, called on every accepted edge
+	void *obj;																				// handed over to the handler
+};
+volatile s_pcint_pin pcint_pin[MAX_PCINT_PINS];
+uint8_t pcint_pins;
+
+/* dispatch table, vector and bit number of a pin to its slot in pcint_pin + 1, 0 is a pin without debounce data */
+static uint8_t pcint_map[pc_interrupt_vectors][8];
+
+/* debounce data of a registered pin, 0 if the pin is not registered */
+static volatile s_pcint_pin *find_PCINT(uint8_t def_pin) {
+	if (digitalPinToPort(def_pin) == NOT_A_PIN) return 0;
+	uint8_t slot = pcint_map[digitalPinToPCICRbit(def_pin)][digitalPinToPCMSKbit(def_pin)];
+	return (slot) ? &pcint_pin[slot - 1] : 0;
+}
+
 /* function to register a pin interrupt */
 void register_PCINT(uint8_t def_pin) {
 
@@ -145,8 +322,29 @@ void register_PCINT(uint8_t def_pin) {
 	uint8_t port = digitalPinToPort(def_pin);												// need the pin port to get further information as port register
 	if (port == NOT_A_PIN) return;															// return while port was not found
 
-	pcint_vector[vec].PINREG = portInputRegister(port);										// remember the input register
-	pcint_vector[vec].mask |= digitalPinToBitMask(def_pin);									// set the pin bit in the bitmask
+	volatile s_pcint_pin *p = find_PCINT(def_pin);											// a pin registered again reuses its debounce data
+	if (!p && (pcint_pins >= MAX_PCINT_PINS)) return;										// no space left for the debounce data
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!p) {
+			p = &pcint_pin[pcint_pins++];													// debounce data of the pin
+			pcint_map[vec][digitalPinToPCMSKbit(def_pin)] = pcint_pins;						// and the way from the changed bit to it
+		}
+		p->pin_def = def_pin;
+		p->vec = vec;
+		p->bit = digitalPinToBitMask(def_pin);
+		p->level = (*portInputRegister(port) & p->bit) ? 1 : 0;
+		p->event = 0;
+		p->lock = DEBOUNCE * 1000U;
+		p->time = get_micros() - p->lock;													// first edge is accepted right away
+		p->handler = 0;
+		p->obj = 0;
+
+		pcint_vector[vec].PINREG = portInputRegister(port);									// remember the input register
+		pcint_vector[vec].mask |= p->bit;													// set the pin bit in the bitmask
+		uint8_t keep = pcint_vector[vec].chng & ~p->bit;									// the level of the pin is known, seed it as the last status
+		pcint_vector[vec].chng = pcint_vector[vec].curr = keep | ((p->level) ? p->bit : 0);	// so maintain_PCINT() sees no edge at registration
+	}
 
 	*digitalPinToPCICR(def_pin) |= _BV(digitalPinToPCICRbit(def_pin));						// pci functions
 	*digitalPinToPCMSK(def_pin) |= _BV(digitalPinToPCMSKbit(def_pin));						// make the pci active
@@ -155,133 +353,455 @@ void register_PCINT(uint8_t def_pin) {
 	//dbg << "x-v:" << vec << ", m:" << pcint_vector[vec].mask << ", r:" << pcint_vector[vec].chng << ", pin:" << def_pin << '\n';
 }
 
+/* register the pin and route its accepted edges to the handler of the subscriber */
+uint8_t subscribe_PCINT(uint8_t def_pin, pcint_handler handler, void *obj, uint16_t lock_us) {
+	register_PCINT(def_pin);
+	volatile s_pcint_pin *p = find_PCINT(def_pin);
+	if (!p) return 0;																		// no port or no space left
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		p->lock = lock_us;
+		p->handler = handler;
+		p->obj = obj;
+	}
+	return 1;
+}
+
+/* a pin with a fast signal would flood the event queue, its changes are handled by the subscriber in the isr only */
+void quiet_PCINT(uint8_t def_pin) {
+	if (digitalPinToPort(def_pin) == NOT_A_PIN) return;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		pcint_vector[digitalPinToPCICRbit(def_pin)].quiet |= digitalPinToBitMask(def_pin);
+	}
+}
+
+/* accept an edge, remember it for check_PCINT() and tell the subscriber of the pin */
+static void accept_PCINT(volatile s_pcint_pin *p, uint8_t level, uint32_t now) {
+	p->level = level;
+	p->time = now;
+	p->event = (level) ? 3 : 2;
+	if (!p->handler) return;
+	prof_mark(PROF_HOOK_ENTER);
+	p->handler(p->obj, p->pin_def, level, now);
+	prof_mark(PROF_HOOK_EXIT);
+}
+
 /* period check if a pin interrupt had happend */
 uint8_t check_PCINT(uint8_t def_pin, uint8_t debounce) {
-	// need to get vectore 0 - 3, depends on cpu
-	uint8_t vec = digitalPinToPCICRbit(def_pin);											// needed for interrupt handling and to sort out the port
-	uint8_t bit = digitalPinToBitMask(def_pin);												// get the specific bit for the asked pin
+	volatile s_pcint_pin *p = find_PCINT(def_pin);
+	if (!p) return get_pin_status(def_pin);													// not registered, no edges to report
 
-	uint8_t status = pcint_vector[vec].curr & bit ? 1 : 0;									// evaluate the pin status
-	uint8_t prev = pcint_vector[vec].prev & bit ? 1 : 0;									// evaluate the previous pin status
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (p->event) {																		// edge seen by the isr
+			uint8_t event = p->event;
+			p->event = 0;
+			return event;
+		}
+
+		/* the pin changed its level within the lockout and the isr ignored it, take the level once the lockout is over */
+		uint8_t status = (pcint_vector[p->vec].curr & p->bit) ? 1 : 0;
+		uint32_t now = get_micros();
+		if ((status != p->level) && (!debounce || ((now - p->time) >= p->lock))) {
+			accept_PCINT(p, status, now);
+			p->event = 0;
+			return (status) ? 3 : 2;
+		}
+		return p->level;
+	}
+	return 0;
+}
+
+/* time stamp of the last accepted edge, to measure the latency from the pin change to the reaction */
+uint32_t get_PCINT_time(uint8_t def_pin) {
+	uint32_t time = 0;
+	volatile s_pcint_pin *p = find_PCINT(def_pin);
+	if (!p) return 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		time = p->time;
+	}
+	return time;
+}
 
-	if (status == prev) return status;														// check if something had changed since last time
-	if (debounce && ((get_millis() - pcint_vector[vec].time) < DEBOUNCE)) return prev;		// seems there is a change, check if debounce is necassary and done
 
-	pcint_vector[vec].prev ^= bit;															// if we are here, there was a change and debounce check was passed, remember for next time
+/* event ring buffer, one slot stays free to tell full from empty */
+static volatile s_pcint_event pcint_event[PCINT_EVENTS];
+static volatile uint8_t pcint_head;															// next slot to write, isr only
+static volatile uint8_t pcint_tail;															// next slot to read, main loop only
+static volatile uint8_t pcint_lost;
+
+/* producer, called in the isr */
+static void put_PCINT_event(uint8_t vec, uint8_t chng, uint8_t level, uint32_t time) {
+	uint8_t head = pcint_head;
+	uint8_t next = (head + 1) & (PCINT_EVENTS - 1);
+	if (next == pcint_tail) {																// full, the main loop is too slow
+		if (pcint_lost < 0xff) pcint_lost++;
+		return;
+	}
+	pcint_event[head].vec = vec;
+	pcint_event[head].chng = chng;
+	pcint_event[head].level = level;
+	pcint_event[head].time = time;
+	pcint_head = next;																		// publish after the slot is written
+}
 
-	if (status) return 3;																	// pin is 1, old was 0
-	else return 2;																			// pin is 0, old was 1
+/* consumer, called in the main loop */
+uint8_t get_PCINT_event(s_pcint_event *ev) {
+	uint8_t tail = pcint_tail;
+	if (tail == pcint_head) return 0;														// empty
+	ev->vec = pcint_event[tail].vec;
+	ev->chng = pcint_event[tail].chng;
+	ev->level = pcint_event[tail].level;
+	ev->time = pcint_event[tail].time;
+	pcint_tail = (tail + 1) & (PCINT_EVENTS - 1);											// free the slot after it is read
+	return 1;
 }
 
-void(*pci_ptr)(uint8_t vec, uint8_t pin, uint8_t flag);
+uint8_t get_PCINT_lost(void) {
+	return pcint_lost;
+}
 
 
 /* internal function to handle pin change interrupts */
 void maintain_PCINT(uint8_t vec) {
 
 	pcint_vector[vec].curr = *pcint_vector[vec].PINREG  & pcint_vector[vec].mask;			// read the pin port and mask ot unneeded pins
-	pcint_vector[vec].time = get_millis();													// store the time, if we need to debounce it
 
 	if (pcint_vector[vec].chng == pcint_vector[vec].curr) return;							// nothing to do while the same status as last time
 	//dbg << "i-v:" << vec << ", m:" << pcint_vector[vec].mask << ", c:" << pcint_vector[vec].curr << ", n:" << pcint_vector[vec].chng << ", x:" << (pcint_vector[vec].curr ^ pcint_vector[vec].chng) << '\n';
 
-	if (pci_ptr) {
-		uint8_t pin_int = pcint_vector[vec].curr ^ pcint_vector[vec].chng;					// evaluate the pin which raised the interrupt
-		pci_ptr(vec, pin_int, pcint_vector[vec].curr);										// callback the interrupt function in user sketch
+	uint8_t pin_int = pcint_vector[vec].curr ^ pcint_vector[vec].chng;						// evaluate the pin which raised the interrupt
+	uint32_t now = get_micros();															// one time stamp for all pins of the vector
+
+	uint8_t bits = pin_int;
+	for (uint8_t i = 0; bits; i++, bits >>= 1) {											// straight from the changed bits to the pins, leading edge debounce per pin
+		if (!(bits & 1) || !pcint_map[vec][i]) continue;									// bit not changed or pin without debounce data
+		volatile s_pcint_pin *p = &pcint_pin[pcint_map[vec][i] - 1];
+		if ((now - p->time) < p->lock) continue;											// within the lockout, bounce
+		uint8_t level = (pcint_vector[vec].curr & p->bit) ? 1 : 0;
+		if (level == p->level) accept_PCINT(p, !level, now);								// the other edge was lost in the lockout, catch up
+		accept_PCINT(p, level, now);
 	}
 
+	if (pin_int & ~pcint_vector[vec].quiet) put_PCINT_event(vec, pin_int, pcint_vector[vec].curr, now);	// everything else is done in the main loop
+
 	pcint_vector[vec].chng = pcint_vector[vec].curr;										// remember the current status to see the change next time
 }
 
 
-/* interrupt vectors to catch pin change interrupts */
-#ifdef PCIE0
-ISR(PCINT0_vect) {
-	maintain_PCINT(0);
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- alarm functions ------------------------------------------------------------------------------------------------------
+* the deadline is kept in get_micros() time, the hal only brings maintain_alarm() to the right place within a millisecond.
+*/
+static volatile uint32_t alarm_time;														// get_micros() the alarm is due
+static volatile alarm_handler alarm_cb;														// 0 while no alarm is pending
+static void * volatile alarm_obj;
+
+void set_alarm(uint32_t wait_us, alarm_handler handler, void *obj) {
+	if (wait_us < ALARM_SLACK) wait_us = ALARM_SLACK;										// the compare match needs some ticks ahead
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		alarm_time = get_micros() + wait_us;
+		alarm_cb = handler;
+		alarm_obj = obj;
+		start_alarm(wait_us);
+	}
 }
-#endif
 
-#ifdef PCIE1
-ISR(PCINT1_vect) {
-	maintain_PCINT(1);
+void clear_alarm(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		alarm_cb = 0;
+		stop_alarm();
+	}
 }
-#endif
 
-#ifdef PCIE2
-ISR(PCINT2_vect) {
-	maintain_PCINT(2);
+/* isr, the hal calls it once per millisecond till the deadline is in reach */
+void maintain_alarm(void) {
+	if (alarm_cb && ((int32_t)(alarm_time - get_micros()) > ALARM_SLACK)) return;			// not the millisecond of the deadline yet
+	stop_alarm();
+	alarm_handler cb = alarm_cb;
+	alarm_cb = 0;
+	if (cb) cb(alarm_obj);
 }
-#endif
+//- -----------------------------------------------------------------------------------------------------------------------
+
 
-#ifdef PCIE3
-ISR(PCINT3_vect) {
-	maintain_PCINT(3);
+/*-- adc functions --------------------------------------------------------------------------------------------------------
+* the block sum fits 16 bit, 16 samples of 10 bit. the filter works on the sums, so there is no division at all.
+*/
+volatile uint8_t adc_load;
+static uint16_t adc_sum;																	// sum of the running block
+static uint8_t adc_cnt;																		// samples in the running block
+static uint8_t adc_block_load;																// adc_load at the start of the running block
+static uint8_t adc_skip;																	// first block after the start, reference is settling
+static volatile uint16_t adc_filt[2];														// rest and load channel
+
+void init_adc(uint8_t pin_def) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		adc_sum = 0;
+		adc_cnt = 0;
+		adc_skip = 1;
+		adc_filt[0] = adc_filt[1] = 0;
+	}
+	start_adc(pin_def);
+}
+
+/* isr, adds the sample to the block and filters full blocks into their channel */
+void maintain_adc(uint16_t value) {
+	if (!adc_cnt) adc_block_load = adc_load ? 1 : 0;
+	adc_sum += value;
+	if (++adc_cnt < ADC_OVERSAMPLE) return;
+
+	uint16_t sum = adc_sum;
+	adc_sum = 0;
+	adc_cnt = 0;
+	if (adc_skip) adc_skip = 0;																// drop the first block
+	else if ((adc_load ? 1 : 0) != adc_block_load) return;									// motors started or stopped within the block
+	else if (!adc_filt[adc_block_load]) adc_filt[adc_block_load] = sum;						// first block of the channel, no history
+	else adc_filt[adc_block_load] += (int16_t)(sum - adc_filt[adc_block_load]) >> ADC_FILTER;
+}
+
+uint16_t get_adc(uint8_t load) {
+	uint16_t value;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = adc_filt[load ? 1 : 0];
+	}
+	return value;
 }
-#endif
 //- -----------------------------------------------------------------------------------------------------------------------
 
 
-/*-- timer functions ------------------------------------------------------------------------------------------------------
-* as i don't want to depend on the arduino timer while it is not possible to add some time after the arduino was sleeping
-* i defined a new timer. to keep it as flexible as possible you can configure the different timers in the arduino by handing
-* over the number of the timer you want to utilize. as timer are very vendor related there is the need to have at least
-* timer 0 available for all different hardware.
+/*-- twi functions --------------------------------------------------------------------------------------------------------
+* every transfer in the queue is the address, the length and the bytes. twi_begin() reserves the header, twi_end() writes
+* the length and publishes the transfer by moving twi_head, so the isr never sees a half written one.
 */
-// https://github.com/zkemble/millis/blob/master/millis/
-volatile uint32_t milliseconds;
+static uint8_t twi_buf[TWI_QUEUE];
+static volatile uint8_t twi_head;															// end of the published transfers, main loop only
+static volatile uint8_t twi_tail;															// next byte for the bus, isr only
+static uint8_t twi_wr;																		// write position of the open transfer
+static uint8_t twi_hdr;																		// header of the open transfer
+static uint8_t twi_left;																	// bytes left of the transfer on the bus
+static uint8_t twi_active;																	// address was sent, a transfer is on the bus
+static volatile uint8_t twi_running;														// isr works on the queue
+
+uint8_t twi_free(void) {
+	return (TWI_QUEUE - 1) - ((twi_wr - twi_tail) & (TWI_QUEUE - 1));						// the open transfer counts as well
+}
 
-void init_millis_timer0() {
-	dbg << F("init timer0\n");
-	//power_timer0_enable();
+uint8_t twi_begin(uint8_t addr) {
+	while (twi_free() < 2);																	// wait for the isr
+	twi_hdr = twi_wr;
+	twi_buf[twi_hdr] = addr;
+	twi_wr = (twi_wr + 2) & (TWI_QUEUE - 1);
+	return 1;
+}
 
-	TCCR0A = _BV(WGM01);																	// CTC mode
-	TCCR0B = (_BV(CS01) | _BV(CS00));														// prescaler 64; 16.000.000 / 64 = 250.000 / 2000 = 125 
-	TIMSK0 = _BV(OCIE0A);
-	OCR0A = ((F_CPU / 64) / 2000);
+void twi_write(uint8_t data) {
+	while (!twi_free());																	// queue is full, wait for the isr
+	twi_buf[twi_wr] = data;
+	twi_wr = (twi_wr + 1) & (TWI_QUEUE - 1);
 }
 
-uint32_t get_millis(void) {
-	uint32_t ms;
+void twi_end(void) {
+	twi_buf[(twi_hdr + 1) & (TWI_QUEUE - 1)] = (twi_wr - twi_hdr - 2) & (TWI_QUEUE - 1);
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
-		ms = milliseconds;
+		twi_head = twi_wr;																	// publish
+		if (!twi_running) {																	// bus is idle, wake up the isr
+			twi_running = 1;
+			start_twi();
+		}
+	}
+}
+
+/* isr, called after the start condition and after every byte. ack is 0 if the slave didn't acknowledge, the rest of the
+* transfer is dropped then. hands out the address and the bytes of the transfer, at its end the next one or the stop */
+uint8_t maintain_twi(uint8_t ack, uint8_t *data) {
+	uint8_t tail = twi_tail;
+
+	if (!twi_active) {																		// start condition is on the bus
+		*data = twi_buf[tail] << 1;															// address and write bit
+		twi_left = twi_buf[(tail + 1) & (TWI_QUEUE - 1)];
+		twi_tail = (tail + 2) & (TWI_QUEUE - 1);
+		twi_active = 1;
+		return TWI_SEND;
+	}
+
+	if (!ack) {																				// nobody listens, skip the rest
+		tail = (tail + twi_left) & (TWI_QUEUE - 1);
+		twi_left = 0;
+	}
+	if (twi_left) {
+		*data = twi_buf[tail];
+		twi_tail = (tail + 1) & (TWI_QUEUE - 1);
+		twi_left--;
+		return TWI_SEND;
 	}
-	return ms;
+
+	twi_tail = tail;
+	twi_active = 0;
+	if (tail != twi_head) return TWI_RESTART;												// next transfer is waiting
+	twi_running = 0;
+	return TWI_STOP;
 }
+//- -----------------------------------------------------------------------------------------------------------------------
 
 
 
+/*-- dshot functions ------------------------------------------------------------------------------------------------------
+* crc is the xor of the three nibbles of value and telemetry bit
+*/
+uint16_t dshot_packet(uint16_t value, uint8_t telemetry) {
+	uint16_t data = (value << 1) | (telemetry ? 1 : 0);										// 11 bit value and telemetry request
+	uint8_t crc = (data ^ (data >> 4) ^ (data >> 8)) & 0x0f;
+	return (data << 4) | crc;
+}
 
+uint8_t dshot_check(uint16_t packet) {
+	uint16_t data = packet >> 4;
+	return (((data ^ (data >> 4) ^ (data >> 8)) & 0x0f) == (packet & 0x0f)) ? 1 : 0;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
 
 
-/*-- eeprom functions -----------------------------------------------------------------------------------------------------
-* to make the library more hardware independend all eeprom relevant functions are defined at one point
+/*-- bitmap functions -----------------------------------------------------------------------------------------------------
+* a run which is longer than the rest of the block is cut, so a broken stream can't write behind dst
 */
+const uint8_t *rle_expand(const uint8_t *src, uint8_t *dst, uint16_t len) {
+	while (len) {
+		uint8_t ctrl = pgm_read_byte(src++);
+		uint8_t cnt = (ctrl & 0x7f) + 1;
+		if (cnt > len) cnt = len;
+		len -= cnt;
+
+		if (ctrl & 0x80) {																	// run of one byte
+			uint8_t value = pgm_read_byte(src++);
+			while (cnt--) *dst++ = value;
+		} else {																			// literals
+			while (cnt--) *dst++ = pgm_read_byte(src++);
+		}
+	}
+	return src;
+}
+//- -----------------------------------------------------------------------------------------------------------------------
 
-/* init the eeprom, can be enriched for a serial eeprom as well */
-void init_eeprom(void) {
-	// place the code to init a i2c eeprom
+
+/*-- journal functions ----------------------------------------------------------------------------------------------------
+* crc8 with polynomial 0x07 over sequence, version, length and data. version 0 and 0xff are never used, so an erased
+* slot is never taken as a record, even if the crc happens to fit. a record shorter than the data leaves the rest as it
+* is, so fields added at the end of a struct keep their defaults when an older record is loaded.
+*/
+static uint8_t crc8(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
 }
 
-/* read a specific eeprom address */
-void get_eeprom(uint16_t addr, uint8_t len, void *ptr) {
-	eeprom_read_block((void*)ptr, (const void*)addr, len);									// AVR GCC standard function
+journal::journal(uint16_t start, uint16_t end) : start(start), seq(0xff), pos(0) {
+	uint16_t cnt = (end - start) / JOURNAL_SLOT;
+	slots = (cnt > 127) ? 127 : cnt;
+	head = slots - 1;																		// first record goes to slot 0
 }
 
-/* write a block to a specific eeprom address */
-void set_eeprom(uint16_t addr, uint8_t len, void *ptr) {
-	/* update is much faster, while writes only when needed; needs some byte more space
-	* but otherwise we run in timing issues */
-	eeprom_update_block((const void*)ptr, (void*)addr, len);								// AVR GCC standard function
+uint8_t journal::check(uint8_t slot) {
+	uint16_t addr = start + slot * JOURNAL_SLOT;
+	uint8_t hdr[3], b, crc = 0;
+	get_eeprom(addr, 3, hdr);
+	if ((!hdr[1]) || (hdr[1] == 0xff) || (hdr[2] > JOURNAL_DATA)) return 0;					// erased or garbage
+
+	for (uint8_t i = 0; i < 3; i++) crc = crc8(crc, hdr[i]);
+	for (uint8_t i = 0; i < hdr[2]; i++) {
+		get_eeprom(addr + 3 + i, 1, &b);
+		crc = crc8(crc, b);
+	}
+	get_eeprom(addr + 3 + hdr[2], 1, &b);
+	return (b == crc) ? 1 : 0;
 }
 
-/* and clear the eeprom */
-void clear_eeprom(uint16_t addr, uint16_t len) {
-	uint8_t tB = 0;
-	if (!len) return;
-	for (uint16_t l = 0; l < len; l++) {													// step through the bytes of eeprom
-		set_eeprom(addr + l, 1, (void*)&tB);
+uint8_t journal::load(void *data, uint8_t len) {
+	uint8_t prev, cur;
+	get_eeprom(start, 1, &prev);
+	head = 0;
+	for (uint8_t i = 1; i < slots; i++) {													// end of the chain of consecutive sequences
+		get_eeprom(start + i * JOURNAL_SLOT, 1, &cur);
+		if (cur != (uint8_t)(prev + 1)) break;
+		head = i;
+		prev = cur;
 	}
+
+	for (uint8_t i = 0; i < slots; i++) {													// newest complete record, back from the end of the chain
+		if (check(head)) {
+			uint8_t hdr[3];
+			uint16_t addr = start + head * JOURNAL_SLOT;
+			get_eeprom(addr, 3, hdr);
+			get_eeprom(addr + 3, (hdr[2] < len) ? hdr[2] : len, data);
+			seq = hdr[0];
+			return hdr[1];
+		}
+		head = (head) ? head - 1 : slots - 1;
+	}
+
+	head = slots - 1;																		// nothing stored yet
+	seq = 0xff;
+	return 0;
+}
+
+void journal::save(const void *data, uint8_t len, uint8_t version) {
+	if ((len > JOURNAL_DATA) || (!version) || (version == 0xff)) return;
+
+	uint8_t hdr[3], b;																		// compare with the newest record
+	uint16_t addr = start + head * JOURNAL_SLOT;
+	get_eeprom(addr, 3, hdr);
+	uint8_t same = (hdr[1] == version) && (hdr[2] == len);
+	for (uint8_t i = 0; (same) && (i < len); i++) {
+		get_eeprom(addr + 3 + i, 1, &b);
+		same = (b == ((const uint8_t*)data)[i]);
+	}
+	if (same) {																				// changed back, a staged record is dropped
+		pos = 0;
+		return;
+	}
+
+	rec[0] = seq + 1;
+	rec[1] = version;
+	rec[2] = len;
+	memcpy(&rec[3], data, len);
+	uint8_t crc = 0;
+	for (uint8_t i = 0; i < len + 3; i++) crc = crc8(crc, rec[i]);
+	rec[len + 3] = crc;
+	pos = 1;																				// sequence is written last
 }
 
+uint8_t journal::poll(void) {
+	if ((!pos) || (!ready_eeprom())) return 0;
+	uint8_t slot = (head + 1 < slots) ? head + 1 : 0;
+	uint16_t addr = start + slot * JOURNAL_SLOT;
 
+	if (pos < rec[2] + 4) {
+		set_eeprom(addr + pos, 1, &rec[pos]);
+		pos++;
+		return 1;
+	}
+
+	set_eeprom(addr, 1, &rec[0]);															// the record counts from now on
+	head = slot;
+	seq = rec[0];
+	pos = 0;
+	return 1;
+}
+
+uint8_t journal::pending(void) {
+	return pos ? 1 : 0;
+}
+
+/* the old block had the same field order, so it is copied as it is, fields behind it keep their defaults */
+uint8_t journal::adopt(uint16_t addr, const s_journal_block *blocks, uint8_t cnt, void *data, uint8_t len) {
+	uint16_t magic;
+	get_eeprom(addr, 2, &magic);
+	for (uint8_t i = 0; i < cnt; i++) {
+		if (blocks[i].magic != magic) continue;
+		get_eeprom(addr + 2, (blocks[i].len < len) ? blocks[i].len : len, data);
+		return blocks[i].len;
+	}
+	return 0;
+}
 //- -----------------------------------------------------------------------------------------------------------------------
@@ -10,36 +10,115 @@
 #ifndef _MYFUNC_h
 #define _MYFUNC_h
 
-#if defined(ARDUINO) && ARDUINO >= 100
-	#include "Arduino.h"
+/*-- hardware abstraction -------------------------------------------------------------------------------------------------
+* everything below is written against the arduino/avr register api. on the atmega the real core is used and the hardware
+* specific parts (timer, eeprom, interrupt vectors) are implemented in HAL_atmega.cpp. on a linux host HAL_linux.h
+* emulates the same api with simulated ports, a virtual clock and a file backed eeprom, so the pusher and launcher state
+* machines can be driven without a blaster.
+*/
+#if defined(__AVR__)
+	#if defined(ARDUINO) && ARDUINO >= 100
+		#include "Arduino.h"
+	#else
+		#include "WProgram.h"
+	#endif
+
+	#include <avr/eeprom.h>
+	#include <avr/interrupt.h>
+	#include <util/atomic.h>
 #else
-	#include "WProgram.h"
+	#include "HAL_linux.h"
 #endif
 
-
 #include <stdint.h>
-#include <avr/eeprom.h>
-#include <avr/interrupt.h>
-#include <util/atomic.h>
 
 
+/*-- waittimer and timer service ------------------------------------------------------------------------------------------
+* every armed waittimer sits in a deadline sorted queue of the timer service. timers.poll() in the main loop reads the
+* clock once and only looks at the head of the queue, expired timers are flagged for done() or, if a callback is set,
+* dispatched right away. done() is a flag check then and needs no clock read nor an atomic block. set() may be called
+* from an isr.
+*/
 class waittimer {
+	friend class timerservice;
 
 private:	//---------------------------------------------------------------------------------------------------------
 	uint32_t startTime;
 	uint32_t checkTime;
+	uint8_t  micros;																		// 1 if set_us() armed the timer, all times are in us then
+
+	uint32_t deadline;																		// absolute expiry in us, sort key of the queue
+	waittimer *next;																		// next timer in the queue
+	volatile uint8_t queued;																// 1 while in the queue
+	volatile uint8_t fired;																	// set by the timer service, consumed by done()
+	void(*cb)(void *arg);																	// optional callback, dispatched by the timer service
+	void *cb_arg;
+
+	uint32_t now(void);
+	void     arm(uint32_t wait_micros);
 
 public:		//---------------------------------------------------------------------------------------------------------
 	waittimer();
+	~waittimer();
 	uint8_t  done(void);
 	void     set(uint32_t wait_millis);
+	void     set_us(uint32_t wait_micros);
+	void     set_callback(void(*callback)(void *arg), void *arg = 0);
 	uint32_t remain(void);
 	uint8_t  completed(void);
 };
 
+class timerservice {
+
+private:	//---------------------------------------------------------------------------------------------------------
+	waittimer *head;
+
+public:		//---------------------------------------------------------------------------------------------------------
+	void     poll(void);																	// flag or dispatch all expired timers
+	void     insert(waittimer *t);
+	void     remove(waittimer *t);
+};
+extern timerservice timers;
+
+
+/*-- task scheduler -------------------------------------------------------------------------------------------------------
+* cooperative scheduler around the poll() pattern. every loop() pass runs all tasks of priority 0 (the fire path) and
+* then the background tasks by priority till one of them reports that it did some work. a background task should do
+* one slice of work per call and return 1, or 0 if there was nothing to do. so a background slice can delay the fire
+* path by its own run time only, never by a whole display redraw.
+* run time per task and the worst trigger to pusher motor latency are measured in us and printed by report().
+*/
+#define MAX_TASKS 8
+
+class taskscheduler {
+
+private:	//---------------------------------------------------------------------------------------------------------
+	struct s_task {
+		uint8_t(*fn)(void);																	// task function, returns 1 if it did some work
+		uint8_t prio;																		// 0 runs every pass, higher numbers are background
+		const __FlashStringHelper *name;
+		uint16_t max_us;																	// longest run time
+		uint32_t sum_us;																	// sum of run times while working, for the average
+		uint16_t runs;																		// calls which did some work
+	} task[MAX_TASKS];
+	uint8_t cnt;
+	uint32_t max_latency;																	// worst trigger to pusher motor latency in us
+
+	uint8_t exec(uint8_t nr, uint32_t &stamp);
+
+public:		//---------------------------------------------------------------------------------------------------------
+	void add(uint8_t(*fn)(void), uint8_t prio, const __FlashStringHelper *name);			// tasks are kept sorted by priority
+	void run(void);																			// one loop() pass
+	void latency(uint32_t us);																// remember a trigger to pusher motor latency
+	void report(Print &out);																// run time statistics
+};
+extern taskscheduler tasks;
+//- -----------------------------------------------------------------------------------------------------------------------
+
 
 //- pin definition ----------------------------------------------------------------------------------------------------------
 #define pc_interrupt_vectors 3																// amount of pin change interrupt vectors
+#define NO_PIN 0xff																			// pin not connected, for optional pins
 
 #define pinD0 (0)		// &DDRD, &PORTD, &PIND, 16, PCINT16, &PCICR, &PCMSK2, PCIE2, 2
 #define pinD1 (1)
@@ -71,50 +150,233 @@ public:		//---------------------------------------------------------------------
 
 
 /*-- pin functions --------------------------------------------------------------------------------------------------------
-* all pins defined as a struct, holding all information regarding port, pin, ddr, etc.
-* as we support different arduino hw i tried to make it as flexible as possible. everything is defined in seperate
-* hw specific files. the struct and pin manipulation function is defined in HAL_atmega.h because it is similar for all
-* ATMEL hardware, the pin structs are defined in HAL_atmega_<model> while different for each cpu type. here we reference
-* only on the functions defined in HAL_<type>_<model>.
+* all pins are addressed by the arduino pin number, port, bit and ddr are resolved via the arduino pin tables.
+* on the atmega these tables come from the arduino core, on a linux host HAL_linux.h provides the same tables for an
+* atmega328 with simulated port registers, so the functions in myfunc.cpp are the same for both backends.
 */
 void set_pin_output(uint8_t pin_def);
 void set_pin_input(uint8_t pin_def);
 void set_pin_high(uint8_t pin_def);
 void set_pin_low(uint8_t pin_def);
 uint8_t get_pin_status(uint8_t pin_def);
+
+/* same pins as compile time type, Pin<pinB5>::high(). port register and bit are resolved from the pin number by the
+* compiler, with the constant address avr-gcc makes a single sbi/cbi/sbic out of it instead of the table lookups above.
+* for the hot paths, like braking the pusher in the pin change isr. atmega328 layout, same as the pin definition. */
+template <uint8_t P>
+struct Pin {
+	static const uint8_t def = P;															// arduino pin number
+	static const uint8_t bit = 1 << ((P < 8) ? P : (P < 14) ? P - 8 : P - 14);				// bit mask within the port
+	static const uint8_t vec = (P < 8) ? 2 : (P < 14) ? 0 : 1;								// pin change vector, as digitalPinToPCICRbit()
+
+	static inline volatile uint8_t &ddr()  { return (P < 8) ? DDRD : (P < 14) ? DDRB : DDRC; }
+	static inline volatile uint8_t &port() { return (P < 8) ? PORTD : (P < 14) ? PORTB : PORTC; }
+	static inline volatile uint8_t &pin()  { return (P < 8) ? PIND : (P < 14) ? PINB : PINC; }
+
+	static inline void output() { ddr() |= bit; }
+	static inline void input()  { ddr() &= ~bit; }
+	static inline void high()   { port() |= bit; }
+	static inline void low()    { port() &= ~bit; }
+	static inline uint8_t read() { return (pin() & bit) ? 1 : 0; }
+};
 //- -----------------------------------------------------------------------------------------------------------------------
 
 
 /*-- interrupt functions --------------------------------------------------------------------------------------------------
-* interrupts again are very hardware supplier related, therefor we define her some external functions which needs to be
-* defined in the hardware specific HAL file. for ATMEL it is defined in HAL_atmega.h.
+* interrupts again are very hardware supplier related, the interrupt vectors are defined in the hardware specific HAL file.
+* for ATMEL it is HAL_atmega.cpp, on a linux host pin changes are injected by hal_sim_set_input() in HAL_linux.cpp.
 * you can also use the arduino standard timer for a specific hardware by interlinking the function call to getmillis()
+* every registered pin is debounced on the leading edge: the first edge counts at once, then the pin is locked for
+* DEBOUNCE ms. any object can subscribe a handler to a pin, the isr goes from the changed bits through a dispatch table
+* straight to the handler of the pin, so a handler sees only accepted edges of its own pin. handlers run in the pin
+* change isr, or in check_PCINT() when it catches up a level the isr ignored in the lockout.
 */
-#define DEBOUNCE  5																			// debounce time for periodic check if an interrupt was raised
-extern void(*pci_ptr)(uint8_t vec, uint8_t pin, uint8_t flag);
+#define DEBOUNCE  5																			// lockout time in ms after an accepted edge
+#define MAX_PCINT_PINS 8																	// amount of pins with debounce data
+typedef void(*pcint_handler)(void *obj, uint8_t pin_def, uint8_t level, uint32_t time);		// obj as given to subscribe_PCINT(), time is get_micros() of the edge
 void register_PCINT(uint8_t pin_def);
+uint8_t subscribe_PCINT(uint8_t pin_def, pcint_handler handler, void *obj = 0, uint16_t lock_us = DEBOUNCE * 1000U);	// 0 if the pin table is full
+void quiet_PCINT(uint8_t pin_def);															// changes of the pin are not queued as events, for fast signals handled in the isr only
 uint8_t check_PCINT(uint8_t pin_def, uint8_t debounce);
+uint32_t get_PCINT_time(uint8_t pin_def);													// get_micros() of the last accepted edge of the pin
 void maintain_PCINT(uint8_t vec);
+
+/* every pin change is also queued as an event for the main loop. the ring buffer has a single producer (the isr) and a
+* single consumer (the main loop), head is written by the producer only and tail by the consumer only, both are single
+* bytes, so no interrupt lock is needed. work which doesn't need to happen in the isr should be done on the events. */
+#define PCINT_EVENTS 16																		// size of the ring buffer, power of 2
+struct s_pcint_event {
+	uint8_t vec;																			// pin change vector
+	uint8_t chng;																			// changed pins as port bit mask
+	uint8_t level;																			// levels of all registered pins of the port after the change
+	uint32_t time;																			// get_micros() of the change
+};
+uint8_t get_PCINT_event(s_pcint_event *ev);													// copies the oldest event into ev, 0 if there is none
+uint8_t get_PCINT_lost(void);																// events dropped because the buffer was full
 //- -----------------------------------------------------------------------------------------------------------------------
 
 
 /*-- timer functions ------------------------------------------------------------------------------------------------------
 * as i need timer0 interrupt for the encoder service i have to define an own millis() timer here.
+* timer0 runs in ctc mode with a compare match every millisecond, the isr in the main sketch counts milliseconds.
+* get_micros() adds the running timer0 count to it, resolution is one timer tick (4us at 16 MHz).
 */
 // https://github.com/zkemble/millis/blob/master/millis/
 extern volatile uint32_t milliseconds;
 void init_millis_timer0();																	// initialize timer0
 uint32_t get_millis(void);																	// get the current time in millis
+uint32_t get_micros(void);																	// get the current time in micros, wraps after ~71 minutes
+
+
+/*-- alarm functions ------------------------------------------------------------------------------------------------------
+* one shot alarm for the few things which can't wait for the main loop, like the brake point of the pusher. the handler
+* runs in the isr at the given time, a pass of the main loop doesn't delay it. there is one alarm only, a new one
+* replaces the pending one. on the atmega the timer0 compare match B isr checks the deadline once per millisecond at the
+* sub millisecond position of it, so the alarm is exact to one timer tick. start_alarm() and stop_alarm() are hardware
+* related and defined in the HAL file.
+*/
+#define ALARM_SLACK 8																		// us, an alarm due within this time fires right away
+
+typedef void(*alarm_handler)(void *obj);
+void set_alarm(uint32_t wait_us, alarm_handler handler, void *obj = 0);						// ISR-SAFE, handler(obj) is called in wait_us
+void clear_alarm(void);																		// ISR-SAFE, drops the pending alarm
+void start_alarm(uint32_t wait_us);															// hal, maintain_alarm() at the sub millisecond position of wait_us
+void stop_alarm(void);																		// hal
+void maintain_alarm(void);																	// called by the hal isr, fires the handler when it is due
+
+
+/*-- adc functions --------------------------------------------------------------------------------------------------------
+* the analog input is sampled in the background, on the atmega the timer0 compare match starts a conversion every
+* millisecond and the adc isr hands the result to maintain_adc(). ADC_OVERSAMPLE samples are summed up to one block,
+* blocks are filtered by an exponential average with a weight of 1 / 2^ADC_FILTER. the main code tells by adc_load if
+* the motors are running, a block goes to the load or the rest channel, blocks with a load change inside are dropped.
+* get_adc() returns the filtered block sum, so ADC_OVERSAMPLE times the adc value, 0 till the first block is done.
+* start_adc() is hardware related and defined in the HAL file.
+*/
+#define ADC_OVERSAMPLE 16																	// samples per block, 16 ms
+#define ADC_FILTER     3																	// block weight 1/8, ~128 ms time constant
+
+extern volatile uint8_t adc_load;															// set while the motors draw current
+void init_adc(uint8_t pin_def);																// clear the channels and start the background conversion
+void start_adc(uint8_t pin_def);															// hal, one conversion per millisecond into maintain_adc()
+void maintain_adc(uint16_t value);															// called by the adc isr with every result
+uint16_t get_adc(uint8_t load);																// filtered block sum of the rest (0) or load (1) channel
+
+
+/*-- twi functions --------------------------------------------------------------------------------------------------------
+* queued i2c master transmitter, the display data is written into a ring buffer and sent by the twi isr in the
+* background, one byte per interrupt. a transfer is written with twi_begin(), twi_write() and twi_end(), the isr sees it
+* only after twi_end(). twi_free() tells the room left, a caller checks it before a bigger update and comes back later
+* if the last one is still on the bus. twi_write() waits for the isr if the queue is full, so a single transfer has to
+* be smaller than the queue. init_twi() and start_twi() are hardware related and defined in the HAL file.
+*/
+#define TWI_QUEUE   256																		// size of the ring buffer, power of 2, max 256
+#define TWI_SEND    0																		// maintain_twi(), send the byte
+#define TWI_RESTART 1																		// stop and start of the next transfer
+#define TWI_STOP    2																		// stop, the queue is empty
+
+void init_twi(uint32_t clock);																// hal, bus clock in Hz, 400 kHz is fine for the display
+void start_twi(void);																		// hal, start condition, the isr does the rest
+uint8_t twi_begin(uint8_t addr);															// open a transfer to the 7 bit address
+void twi_write(uint8_t data);																// add a byte to the open transfer
+void twi_end(void);																			// hand the transfer over to the isr
+uint8_t twi_free(void);																		// bytes left in the queue
+uint8_t maintain_twi(uint8_t ack, uint8_t *data);											// called by the twi isr, next byte for the bus
+
+
+/*-- profiling ------------------------------------------------------------------------------------------------------------
+* with PROFILE defined every marker is a single 'out' to GPIOR0. the register is not used otherwise, so the firmware runs
+* unchanged, but a simulator can watch the writes and stamp them with the cycle counter, see host/bench_simavr.c.
+* build with -DPROFILE (arduino-cli: --build-property build.extra_flags=-DPROFILE) or enable the define below.
+*/
+//#define PROFILE
+
+#define PROF_T0_ENTER     0x10																// timer0 compare isr, encoder service
+#define PROF_T0_EXIT      0x11
+#define PROF_PCINT_ENTER  0x20																// pin change isr, + vector number
+#define PROF_PCINT_EXIT   0x28																// + vector number
+#define PROF_HOOK_ENTER   0x30																// pin change handler of a subscriber
+#define PROF_HOOK_EXIT    0x31
+#define PROF_LOOP         0x40																// start of every loop() pass
+
+#if defined(PROFILE) && defined(GPIOR0)
+	#define prof_mark(id) GPIOR0 = (id)
+#else
+	#define prof_mark(id)
+#endif
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- dshot functions ------------------------------------------------------------------------------------------------------
+* digital esc protocol, a frame has 16 bits: 11 bit value (0 stop, 1 - 47 commands, 48 - 2047 throttle), 1 bit telemetry
+* request and a 4 bit crc over the first 12 bits, sent msb first. the encoding is hardware independent, the bits are
+* sent by the launcher output, see DshotClass in motors.h.
+*/
+#define DSHOT_MIN 48																		// lowest throttle value
+#define DSHOT_MAX 2047																		// full throttle
+uint16_t dshot_packet(uint16_t value, uint8_t telemetry);									// frame for value, with the crc
+uint8_t dshot_check(uint16_t packet);														// 1 if the crc of the frame fits
+//- -----------------------------------------------------------------------------------------------------------------------
+
+
+/*-- bitmap functions -----------------------------------------------------------------------------------------------------
+* bitmaps are kept rle compressed in flash, in the tile order of the display. a tile row of 8 pixel lines is one block
+* of width bytes, every byte is a column of 8 pixels with the lsb on top, so a block is exactly one u8g2 page. a control
+* byte below 0x80 is followed by control + 1 literal bytes, from 0x80 on the next byte is repeated control - 0x7f times.
+* host/xbm2rle.cpp converts an xbm file into a header.
+*/
+const uint8_t *rle_expand(const uint8_t *src, uint8_t *dst, uint16_t len);					// expand len bytes from flash, returns the next block
+//- -----------------------------------------------------------------------------------------------------------------------
 
 
 /*-- eeprom functions -----------------------------------------------------------------------------------------------------
 * eeprom is very hardware supplier related, therefor we define her some external functions which needs to be defined
-* in the hardware specific HAL file. for ATMEL it is defined in HAL_atmega.h.
+* in the hardware specific HAL file. for ATMEL it is defined in HAL_atmega.cpp, for linux in HAL_linux.cpp.
 */
 void init_eeprom(void);
 void get_eeprom(uint16_t addr, uint8_t len, void *ptr);
 void set_eeprom(uint16_t addr, uint8_t len, void *ptr);
 void clear_eeprom(uint16_t addr, uint16_t len);
+uint8_t ready_eeprom(void);																	// 1 if a write can start without waiting for the last one
+
+
+/*-- journal functions ----------------------------------------------------------------------------------------------------
+* settings journal in the eeprom. every save appends a record to the next slot of a ring, so the writes are spread over
+* the whole area. a record is sequence, version, length, data and a crc8. the sequence is written last, so a record
+* counts only when it is complete, a power loss mid-write leaves the record before it as the newest one.
+* load() reads only the sequence byte of every slot to find the end of the chain, the crc is checked from there back.
+* save() stages the record in ram, poll() writes one byte per call and only if the eeprom is ready, so a save never
+* stalls the main loop. a save while the last one is still written restarts the same slot with the new data.
+* adopt() takes over a fixed block of an older firmware, a 16 bit magic followed by the data, the magic gives the length.
+*/
+#define JOURNAL_DATA 20																		// largest record data, fixes the slot size
+#define JOURNAL_SLOT (JOURNAL_DATA + 4)														// sequence, version, length, data and crc
+
+struct s_journal_block {
+	uint16_t magic;																			// magic in front of the block
+	uint8_t len;																			// data bytes behind it
+};
+
+class journal {
+
+private:	//---------------------------------------------------------------------------------------------------------
+	uint16_t start;																			// eeprom address of the first slot
+	uint8_t slots;																			// slots in the ring, at most 127 for the sequence
+	uint8_t head;																			// slot of the newest record
+	uint8_t seq;																			// sequence of the newest record
+	uint8_t rec[JOURNAL_SLOT];																// staged record
+	uint8_t pos;																			// next byte of rec to write, 0 is idle
+
+	uint8_t check(uint8_t slot);															// 1 if the slot holds a complete record
+
+public:		//---------------------------------------------------------------------------------------------------------
+	journal(uint16_t start, uint16_t end);													// ring from start to end - 1
+	uint8_t load(void *data, uint8_t len);													// newest record into data, returns its version, 0 if none
+	void save(const void *data, uint8_t len, uint8_t version);								// stage a new record, nothing if unchanged
+	uint8_t poll(void);																		// writes the next byte, 1 if it did
+	uint8_t pending(void);																	// a record is still staged
+	uint8_t adopt(uint16_t addr, const s_journal_block *blocks, uint8_t cnt, void *data, uint8_t len);	// old block at addr into data, returns its length, 0 if no magic fits
+};
 
 
 /*-- serial print functions -----------------------------------------------------------------------------------------------
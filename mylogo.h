@@ -2,7 +2,7 @@
 *  FDL-2 arduino implementation
 *  2018-01-17 <trilu@gmx.de> Creative Commons - http://creativecommons.org/licenses/by-nc-sa/3.0/de/
 * - -----------------------------------------------------------------------------------------------------------------------
-* - the logo for the 0.9inch oled display ---------------------------------------------------------------------------------
+* - bitmaps for the 0.9inch oled display, made by host/xbm2rle.cpp, don't edit --------------------------------------------
 *   special thanks to Jesse Kovarovics http://www.projectfdl.com to make this happen
 * - -----------------------------------------------------------------------------------------------------------------------
 */
@@ -10,50 +10,33 @@
 #ifndef _MYLOGO_h
 #define _MYLOGO_h
 
-static const uint8_t testbmp_bits[] PROGMEM = {
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1e, 0x0f, 0x00, 0x10, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00,
-	0x00, 0x04, 0x04, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0xc4, 0x84, 0x0f, 0x10, 0xe0, 0x0f, 0x1f,
-	0xff, 0xc3, 0x07, 0x00, 0xfc, 0x83, 0x0f, 0x00, 0x00, 0xa4, 0x44, 0x10, 0x10, 0x10, 0x88, 0x20, 0x66, 0x22, 0x08, 0x00, 0x10, 0x40, 0x10, 0x00,
-	0x00, 0xa4, 0x24, 0x20, 0x10, 0x10, 0x48, 0x40, 0x22, 0x12, 0x10, 0x00, 0x10, 0x20, 0x20, 0x00, 0x00, 0xa8, 0xe4, 0x3f, 0x10, 0x10, 0x40, 0x40,
-	0x22, 0xf2, 0x1f, 0x00, 0x10, 0x20, 0x20, 0x00, 0x00, 0x28, 0x23, 0x00, 0x10, 0x10, 0x40, 0x40, 0x22, 0x12, 0x00, 0x00, 0x10, 0x20, 0x20, 0x00,
-	0x00, 0x18, 0x23, 0x00, 0x10, 0x10, 0x40, 0x40, 0x22, 0x12, 0x00, 0x00, 0x10, 0x20, 0x20, 0x00, 0x00, 0x18, 0x43, 0x20, 0x10, 0x10, 0x88, 0x20,
-	0x22, 0x22, 0x10, 0x00, 0x10, 0x40, 0x10, 0x00, 0x00, 0x18, 0x82, 0x1f, 0xfe, 0xe1, 0x07, 0x1f, 0x67, 0xc6, 0x0f, 0x00, 0xe0, 0x87, 0x0f, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0xfc, 0xff, 0x7f, 0xf0, 0x07, 0x00, 0x80, 0x7f, 0x78, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0xff, 0xff, 0xf0, 0x07,
-	0x00, 0x80, 0xe3, 0x78, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0xc3, 0xc1, 0x01, 0x00, 0x80, 0xc1, 0x70, 0x1c, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x30, 0x30, 0x83, 0xc3, 0x01, 0x00, 0x80, 0xc0, 0xe0, 0x0c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x33, 0x03, 0xc3, 0x01,
-	0x00, 0x00, 0xe0, 0xc0, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x03, 0x03, 0xc3, 0x01, 0x00, 0x00, 0x70, 0xc0, 0x07, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0xf0, 0x03, 0x03, 0xc3, 0x01, 0xfc, 0x07, 0x38, 0x80, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x03, 0x03, 0xc3, 0x41,
-	0xfc, 0x07, 0x1c, 0xc0, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x03, 0x03, 0xc3, 0xe1, 0x00, 0x00, 0x0e, 0xe0, 0x0e, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x30, 0x00, 0x83, 0xc3, 0xe1, 0x00, 0x00, 0x07, 0x60, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x00, 0xc3, 0xc1, 0xe1,
-	0x00, 0xc0, 0x03, 0x70, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0xc3, 0xff, 0xf0, 0xff, 0x00, 0xc0, 0xff, 0xfc, 0x7c, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0xfc, 0xc3, 0x7f, 0xf0, 0xff, 0x00, 0xc0, 0xff, 0x7c, 0x7c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x18, 0x07, 0x00,
-	0x00, 0x10, 0x00, 0x20, 0x00, 0x00, 0x60, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x18, 0x04, 0x00, 0x60, 0x10, 0x06, 0x21, 0x10, 0x06, 0x01, 0x10,
-	0x06, 0x50, 0x00, 0x80, 0x40, 0x00, 0x04, 0x00, 0xb0, 0x10, 0xcb, 0xfb, 0x3c, 0xcf, 0x73, 0x3c, 0x0b, 0xf0, 0x64, 0xe0, 0xf3, 0x1c, 0x44, 0x02,
-	0x90, 0x10, 0x49, 0x20, 0xe4, 0x59, 0x42, 0x04, 0x03, 0x90, 0x25, 0x80, 0x90, 0x11, 0x44, 0x02, 0xf0, 0x10, 0x4f, 0x20, 0x84, 0x59, 0x42, 0x04,
-	0x0e, 0x90, 0x3d, 0x80, 0x10, 0x10, 0x44, 0x02, 0x10, 0x10, 0xc1, 0x20, 0x04, 0x49, 0x42, 0x0c, 0x08, 0x90, 0x18, 0x80, 0x10, 0x10, 0x44, 0x02,
-	0xf0, 0x3c, 0x8f, 0xe3, 0x04, 0x4f, 0xf2, 0x38, 0x0f, 0xf0, 0x18, 0x80, 0x13, 0x3c, 0xcf, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+/* host/mylogo.xbm, 128 x 64 pixel, 543 bytes instead of 1024, expand every tile row with rle_expand() */
+#define logo_width  128
+#define logo_rows   8
 
-#endif
+static const uint8_t logo_rle[] PROGMEM = {
+	0xff, 0x00, 0x88, 0x00, 0x0d, 0x04, 0xfc, 0x04, 0x04, 0xc0, 0x20, 0xe0, 0x04, 0x04, 0xfc, 0x04, 0x00, 0x80, 0x40, 0x84, 0x20, 0x01, 0x40, 0x80,
+	0x83, 0x00, 0x02, 0x02, 0x02, 0xfe, 0x86, 0x00, 0x00, 0xc0, 0x85, 0x20, 0x04, 0xe0, 0x00, 0x00, 0x80, 0x40, 0x84, 0x20, 0x10, 0x40, 0x80, 0x00,
+	0x20, 0xe0, 0x60, 0x20, 0x20, 0xe0, 0x60, 0x20, 0x20, 0xe0, 0x00, 0x00, 0x80, 0x40, 0x84, 0x20, 0x01, 0x40, 0x80, 0x8c, 0x00, 0x02, 0x20, 0x20,
+	0xfc, 0x84, 0x20, 0x82, 0x00, 0x01, 0x80, 0x40, 0x84, 0x20, 0x01, 0x40, 0x80, 0x89, 0x00, 0x8a, 0x00, 0x0b, 0x1f, 0x1c, 0x03, 0x00, 0x01, 0x0e,
+	0x1e, 0x01, 0x00, 0x00, 0x07, 0x09, 0x85, 0x11, 0x00, 0x09, 0x82, 0x00, 0x82, 0x10, 0x00, 0x1f, 0x83, 0x10, 0x82, 0x00, 0x00, 0x0f, 0x85, 0x10,
+	0x04, 0x08, 0x00, 0x00, 0x07, 0x08, 0x84, 0x10, 0x10, 0x08, 0x07, 0x00, 0x10, 0x1f, 0x10, 0x00, 0x00, 0x1f, 0x10, 0x00, 0x00, 0x1f, 0x10, 0x00,
+	0x07, 0x09, 0x85, 0x11, 0x00, 0x09, 0x8e, 0x00, 0x00, 0x0f, 0x85, 0x10, 0x03, 0x00, 0x00, 0x07, 0x08, 0x84, 0x10, 0x01, 0x08, 0x07, 0x89, 0x00,
+	0x99, 0x00, 0x94, 0xc0, 0x00, 0x80, 0x83, 0x00, 0x86, 0xc0, 0x93, 0x00, 0x02, 0xc0, 0xc0, 0xe0, 0x82, 0x60, 0x02, 0xe0, 0xc0, 0x80, 0x82, 0x00,
+	0x83, 0xc0, 0x82, 0x00, 0x84, 0xc0, 0x98, 0x00, 0x9b, 0x00, 0x0d, 0xff, 0xff, 0x38, 0x38, 0x7c, 0x7c, 0x00, 0x00, 0x07, 0x07, 0x00, 0x00, 0xff,
+	0xff, 0x83, 0x00, 0x03, 0x01, 0x83, 0xff, 0xfe, 0x83, 0x00, 0x82, 0xff, 0x83, 0x00, 0x04, 0xc0, 0xe0, 0xc0, 0x00, 0x00, 0x88, 0x30, 0x83, 0x00,
+	0x08, 0x03, 0x81, 0xc0, 0xe0, 0x70, 0x38, 0x1c, 0x0f, 0x07, 0x83, 0x00, 0x08, 0x01, 0xc3, 0xef, 0x7e, 0x3c, 0x7c, 0xef, 0xc7, 0x81, 0x9a, 0x00,
+	0x99, 0x00, 0x03, 0x06, 0x06, 0x07, 0x07, 0x83, 0x06, 0x83, 0x00, 0x03, 0x06, 0x06, 0x07, 0x07, 0x83, 0x06, 0x02, 0x07, 0x03, 0x01, 0x82, 0x00,
+	0x01, 0x06, 0x06, 0x82, 0x07, 0x83, 0x06, 0x82, 0x07, 0x8d, 0x00, 0x83, 0x07, 0x85, 0x06, 0x03, 0x00, 0x00, 0x06, 0x06, 0x82, 0x07, 0x07, 0x02,
+	0x00, 0x00, 0x06, 0x07, 0x07, 0x06, 0x06, 0x98, 0x00, 0x83, 0x00, 0x08, 0xe0, 0xb0, 0x90, 0xe0, 0x00, 0x00, 0x04, 0x04, 0xfc, 0x82, 0x00, 0x26,
+	0xe0, 0xb0, 0x90, 0xe0, 0x00, 0x00, 0xe0, 0x20, 0x30, 0x20, 0x00, 0x20, 0x20, 0xf8, 0x20, 0x20, 0x00, 0x00, 0xe0, 0x20, 0x30, 0x60, 0x40, 0xc0,
+	0xe0, 0x30, 0x30, 0xe0, 0xc0, 0x00, 0xe0, 0x20, 0x30, 0xe0, 0x00, 0x00, 0x20, 0x2c, 0xec, 0x82, 0x00, 0x09, 0xe0, 0x20, 0x30, 0x20, 0x00, 0x00,
+	0x60, 0xf0, 0x90, 0xa0, 0x87, 0x00, 0x0a, 0xfc, 0x20, 0x30, 0xe0, 0xc0, 0x00, 0xe0, 0x80, 0x80, 0xe0, 0x20, 0x85, 0x00, 0x0f, 0x20, 0x20, 0xf8,
+	0x20, 0x20, 0x00, 0x00, 0xe0, 0x20, 0x30, 0x60, 0x40, 0x00, 0x20, 0x2c, 0xec, 0x82, 0x00, 0x02, 0x04, 0x04, 0xfc, 0x82, 0x00, 0x03, 0xe0, 0x00,
+	0x00, 0xe0, 0x85, 0x00, 0x83, 0x00, 0x00, 0x03, 0x82, 0x02, 0x08, 0x00, 0x00, 0x02, 0x02, 0x03, 0x02, 0x00, 0x00, 0x03, 0x82, 0x02, 0x05, 0x00,
+	0x00, 0x01, 0x03, 0x02, 0x02, 0x82, 0x00, 0x05, 0x03, 0x02, 0x02, 0x00, 0x00, 0x03, 0x84, 0x00, 0x17, 0x03, 0x02, 0x02, 0x03, 0x00, 0x00, 0x03,
+	0x00, 0x00, 0x03, 0x00, 0x00, 0x02, 0x02, 0x03, 0x02, 0x00, 0x00, 0x01, 0x03, 0x02, 0x02, 0x00, 0x00, 0x82, 0x02, 0x00, 0x03, 0x87, 0x00, 0x08,
+	0x03, 0x02, 0x02, 0x03, 0x00, 0x08, 0x08, 0x0f, 0x07, 0x89, 0x00, 0x05, 0x03, 0x02, 0x02, 0x00, 0x00, 0x03, 0x84, 0x00, 0x0f, 0x02, 0x02, 0x03,
+	0x02, 0x00, 0x00, 0x02, 0x02, 0x03, 0x02, 0x00, 0x00, 0x03, 0x02, 0x02, 0x03, 0x85, 0x00 };
 
+#endif